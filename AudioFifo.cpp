@@ -0,0 +1,112 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "headers/AudioFifo.h"
+#include "headers/vst-simd.hpp"
+
+#include <string.h>
+
+AudioFifo::~AudioFifo()
+{
+	freePlanes(planes, numChannels);
+}
+
+void AudioFifo::setCapacity(int numChannels, int frames)
+{
+	freePlanes(planes, this->numChannels);
+
+	this->numChannels = numChannels;
+	capacity          = frames;
+	planes            = allocPlanes(numChannels, frames);
+
+	clear();
+}
+
+void AudioFifo::clear()
+{
+	readPos = 0;
+	count   = 0;
+}
+
+int AudioFifo::write(float *const *data, int frames)
+{
+	if (frames > space()) {
+		frames = space();
+	}
+	if (frames <= 0) {
+		return 0;
+	}
+
+	int writePos = (readPos + count) % capacity;
+	int first    = frames < capacity - writePos ? frames : capacity - writePos;
+
+	for (int channel = 0; channel < numChannels; channel++) {
+		if (!data[channel]) {
+			continue;
+		}
+		memcpy(planes[channel] + writePos, data[channel], first * sizeof(float));
+		memcpy(planes[channel], data[channel] + first, (frames - first) * sizeof(float));
+	}
+
+	count += frames;
+	return frames;
+}
+
+int AudioFifo::writeSilence(int frames)
+{
+	if (frames > space()) {
+		frames = space();
+	}
+	if (frames <= 0) {
+		return 0;
+	}
+
+	int writePos = (readPos + count) % capacity;
+	int first    = frames < capacity - writePos ? frames : capacity - writePos;
+
+	for (int channel = 0; channel < numChannels; channel++) {
+		memset(planes[channel] + writePos, 0, first * sizeof(float));
+		memset(planes[channel], 0, (frames - first) * sizeof(float));
+	}
+
+	count += frames;
+	return frames;
+}
+
+int AudioFifo::read(float **data, int frames)
+{
+	if (frames > count) {
+		frames = count;
+	}
+	if (frames <= 0) {
+		return 0;
+	}
+
+	int first = frames < capacity - readPos ? frames : capacity - readPos;
+
+	for (int channel = 0; channel < numChannels; channel++) {
+		if (!data[channel]) {
+			continue;
+		}
+		memcpy(data[channel], planes[channel] + readPos, first * sizeof(float));
+		memcpy(data[channel] + first, planes[channel], (frames - first) * sizeof(float));
+	}
+
+	readPos = (readPos + frames) % capacity;
+	count -= frames;
+	return frames;
+}
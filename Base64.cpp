@@ -0,0 +1,211 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "headers/Base64.h"
+
+#include <string.h>
+#include <util/sse-intrin.h>
+
+static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static int decodeChar(char c)
+{
+	if (c >= 'A' && c <= 'Z') {
+		return c - 'A';
+	} else if (c >= 'a' && c <= 'z') {
+		return c - 'a' + 26;
+	} else if (c >= '0' && c <= '9') {
+		return c - '0' + 52;
+	} else if (c == '+') {
+		return 62;
+	} else if (c == '/') {
+		return 63;
+	}
+	return -1;
+}
+
+static bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Number of characters before padding and trailing whitespace, or -1
+static ptrdiff_t dataLength(const char *text, size_t length)
+{
+	while (length && isSpace(text[length - 1])) {
+		length--;
+	}
+
+	size_t padding = 0;
+	while (padding < 2 && length > padding && text[length - 1 - padding] == '=') {
+		padding++;
+	}
+
+	size_t count = length - padding;
+	if (count % 4 == 1 || (padding && length % 4)) {
+		return -1;
+	}
+	return (ptrdiff_t)count;
+}
+
+size_t base64EncodedLength(size_t bytes)
+{
+	return (bytes + 2) / 3 * 4;
+}
+
+void base64Encode(const uint8_t *src, size_t bytes, char *dst)
+{
+	const __m128i low6   = _mm_set1_epi32(0x3f);
+	const __m128i byte0  = _mm_set1_epi32(0xff);
+	const __m128i byte1  = _mm_set1_epi32(0xff00);
+	const __m128i above  = _mm_set1_epi8(25);
+	const __m128i digits = _mm_set1_epi8(51);
+	const __m128i plus   = _mm_set1_epi8(61);
+	const __m128i slash  = _mm_set1_epi8(62);
+
+	size_t i = 0;
+
+	// Twelve bytes per step, the 32-bit loads read one byte ahead
+	for (; i + 16 <= bytes; i += 12, dst += 16) {
+		uint32_t lanes[4];
+		for (int lane = 0; lane < 4; lane++) {
+			memcpy(&lanes[lane], src + i + 3 * lane, sizeof(uint32_t));
+		}
+
+		// Big endian 24-bit groups, then one sextet per byte in output order
+		__m128i x = _mm_loadu_si128((const __m128i *)lanes);
+		__m128i v = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(_mm_and_si128(x, byte0), 16), _mm_and_si128(x, byte1)),
+		                         _mm_and_si128(_mm_srli_epi32(x, 16), byte0));
+		__m128i s = _mm_or_si128(
+		        _mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 18), low6),
+		                     _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(v, 12), low6), 8)),
+		        _mm_or_si128(_mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(v, 6), low6), 16),
+		                     _mm_slli_epi32(_mm_and_si128(v, low6), 24)));
+
+		// 'A' + s, moved on at every boundary of the alphabet
+		__m128i offset = _mm_set1_epi8('A');
+		offset         = _mm_add_epi8(offset, _mm_and_si128(_mm_cmpgt_epi8(s, above), _mm_set1_epi8(6)));
+		offset         = _mm_sub_epi8(offset, _mm_and_si128(_mm_cmpgt_epi8(s, digits), _mm_set1_epi8(75)));
+		offset         = _mm_sub_epi8(offset, _mm_and_si128(_mm_cmpgt_epi8(s, plus), _mm_set1_epi8(15)));
+		offset         = _mm_add_epi8(offset, _mm_and_si128(_mm_cmpgt_epi8(s, slash), _mm_set1_epi8(3)));
+
+		_mm_storeu_si128((__m128i *)dst, _mm_add_epi8(s, offset));
+	}
+
+	for (; i + 3 <= bytes; i += 3, dst += 4) {
+		uint32_t v = (uint32_t)src[i] << 16 | (uint32_t)src[i + 1] << 8 | src[i + 2];
+		dst[0]     = alphabet[v >> 18];
+		dst[1]     = alphabet[(v >> 12) & 0x3f];
+		dst[2]     = alphabet[(v >> 6) & 0x3f];
+		dst[3]     = alphabet[v & 0x3f];
+	}
+
+	if (i < bytes) {
+		uint32_t v = (uint32_t)src[i] << 16 | (i + 1 < bytes ? (uint32_t)src[i + 1] << 8 : 0);
+		dst[0]     = alphabet[v >> 18];
+		dst[1]     = alphabet[(v >> 12) & 0x3f];
+		dst[2]     = i + 1 < bytes ? alphabet[(v >> 6) & 0x3f] : '=';
+		dst[3]     = '=';
+	}
+}
+
+bool base64DecodedLength(const char *text, size_t length, size_t &bytes)
+{
+	ptrdiff_t count = dataLength(text, length);
+	if (count < 0) {
+		return false;
+	}
+
+	bytes = (size_t)count / 4 * 3 + (count % 4 ? count % 4 - 1 : 0);
+	return true;
+}
+
+static inline __m128i inRange(__m128i c, char first, char last)
+{
+	return _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8(first - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8(last + 1)));
+}
+
+bool base64Decode(const char *text, size_t length, uint8_t *dst)
+{
+	ptrdiff_t count = dataLength(text, length);
+	if (count < 0) {
+		return false;
+	}
+
+	const __m128i low6  = _mm_set1_epi32(0x3f);
+	const __m128i byte0 = _mm_set1_epi32(0xff);
+	const __m128i byte1 = _mm_set1_epi32(0xff00);
+
+	size_t end = (size_t)count;
+	size_t i   = 0;
+
+	for (; i + 16 <= end; i += 16, dst += 12) {
+		__m128i c = _mm_loadu_si128((const __m128i *)(text + i));
+
+		// Characters from 0x80 up compare negative and match no range
+		__m128i upper = inRange(c, 'A', 'Z');
+		__m128i lower = inRange(c, 'a', 'z');
+		__m128i digit = inRange(c, '0', '9');
+		__m128i plus  = _mm_cmpeq_epi8(c, _mm_set1_epi8('+'));
+		__m128i slash = _mm_cmpeq_epi8(c, _mm_set1_epi8('/'));
+
+		__m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(plus, slash)));
+		if (_mm_movemask_epi8(valid) != 0xffff) {
+			return false;
+		}
+
+		__m128i delta = _mm_or_si128(
+		        _mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')), _mm_and_si128(lower, _mm_set1_epi8(26 - 'a'))),
+		        _mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8(52 - '0')),
+		                     _mm_or_si128(_mm_and_si128(plus, _mm_set1_epi8(62 - '+')),
+		                                  _mm_and_si128(slash, _mm_set1_epi8(63 - '/')))));
+		__m128i s     = _mm_add_epi8(c, delta);
+
+		// Four sextets per lane into a 24-bit group, stored big endian
+		__m128i v = _mm_or_si128(
+		        _mm_or_si128(_mm_slli_epi32(_mm_and_si128(s, low6), 18),
+		                     _mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(s, 8), low6), 12)),
+		        _mm_or_si128(_mm_slli_epi32(_mm_and_si128(_mm_srli_epi32(s, 16), low6), 6), _mm_srli_epi32(s, 24)));
+		__m128i y = _mm_or_si128(_mm_or_si128(_mm_and_si128(_mm_srli_epi32(v, 16), byte0), _mm_and_si128(v, byte1)),
+		                         _mm_slli_epi32(_mm_and_si128(v, byte0), 16));
+
+		uint8_t lanes[16];
+		_mm_storeu_si128((__m128i *)lanes, y);
+		for (int lane = 0; lane < 4; lane++) {
+			memcpy(dst + 3 * lane, lanes + 4 * lane, 3);
+		}
+	}
+
+	uint32_t v    = 0;
+	int      bits = 0;
+	for (; i < end; i++) {
+		int sextet = decodeChar(text[i]);
+		if (sextet < 0) {
+			return false;
+		}
+
+		v = v << 6 | (uint32_t)sextet;
+		bits += 6;
+		if (bits >= 8) {
+			bits -= 8;
+			*dst++ = (uint8_t)(v >> bits);
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,92 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "headers/BlockAccumulator.h"
+#include "headers/vst-simd.hpp"
+
+BlockAccumulator::~BlockAccumulator()
+{
+	freeBuffers();
+}
+
+void BlockAccumulator::freeBuffers()
+{
+	freePlanes(blockInputs, numChannels);
+	freePlanes(blockOutputs, numChannels);
+}
+
+void BlockAccumulator::configure(int blockSize, int numChannels, int maxFrames)
+{
+	freeBuffers();
+
+	if (blockSize > BLOCK_ACCUMULATOR_MAX_FRAMES) {
+		blockSize = BLOCK_ACCUMULATOR_MAX_FRAMES;
+	}
+	this->blockSize   = blockSize > maxFrames ? blockSize : 0;
+	this->numChannels = numChannels < BLOCK_ACCUMULATOR_MAX_CHANNELS ? numChannels
+	                                                                   : BLOCK_ACCUMULATOR_MAX_CHANNELS;
+
+	if (!this->blockSize) {
+		return;
+	}
+
+	blockInputs  = allocPlanes(this->numChannels, this->blockSize);
+	blockOutputs = allocPlanes(this->numChannels, this->blockSize);
+
+	// Never more than a block minus a frame waits for the next pass, and
+	// the output holds the primed block plus at most one finished block
+	inputFifo.setCapacity(this->numChannels, this->blockSize + maxFrames);
+	outputFifo.setCapacity(this->numChannels, 2 * this->blockSize + maxFrames);
+	reset();
+}
+
+void BlockAccumulator::reset()
+{
+	if (!blockSize) {
+		return;
+	}
+
+	inputFifo.clear();
+	outputFifo.clear();
+	outputFifo.writeSilence(blockSize);
+}
+
+void BlockAccumulator::write(float *const *in, int frames)
+{
+	inputFifo.write(in, frames);
+}
+
+bool BlockAccumulator::nextBlock()
+{
+	if (inputFifo.available() < blockSize) {
+		return false;
+	}
+
+	inputFifo.read(blockInputs, blockSize);
+	return true;
+}
+
+void BlockAccumulator::finishBlock()
+{
+	outputFifo.write(blockOutputs, blockSize);
+}
+
+void BlockAccumulator::read(float **out, int frames)
+{
+	outputFifo.read(out, frames);
+}
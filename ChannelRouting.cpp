@@ -0,0 +1,282 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "headers/ChannelRouting.h"
+#include "headers/LevelMeter.h"
+#include "headers/vst-simd.hpp"
+
+#include <ctype.h>
+#include <string.h>
+
+static const char *skipSpaces(const char *text)
+{
+	while (*text && isspace((unsigned char)*text)) {
+		text++;
+	}
+	return text;
+}
+
+// Reads a channel number counted from 1, returns -1 if there is none
+static int parseChannel(const char *&text)
+{
+	text = skipSpaces(text);
+	if (!isdigit((unsigned char)*text)) {
+		return -1;
+	}
+
+	int number = 0;
+	while (isdigit((unsigned char)*text)) {
+		number = number * 10 + (*text++ - '0');
+		if (number > ROUTING_MAX_CHANNELS) {
+			return -1;
+		}
+	}
+
+	text = skipSpaces(text);
+	return number;
+}
+
+ChannelRouting::ChannelRouting()
+{
+	configure("", "", ROUTING_MAX_CHANNELS);
+}
+
+bool ChannelRouting::configure(const char *inputSpec, const char *outputSpec, int numChannels, int numSidechain)
+{
+	this->numChannels  = numChannels < ROUTING_MAX_CHANNELS ? numChannels : ROUTING_MAX_CHANNELS;
+	this->numSidechain = numSidechain < ROUTING_MAX_CHANNELS ? numSidechain : ROUTING_MAX_CHANNELS;
+
+	bool valid = true;
+	if (!parseInputs(inputSpec ? inputSpec : "")) {
+		parseInputs("");
+		valid = false;
+	}
+	if (!parseOutputs(outputSpec ? outputSpec : "")) {
+		parseOutputs("");
+		valid = false;
+	}
+
+	updateSummary();
+	return valid;
+}
+
+// Returns the bit of a channel or 's' and a sidechain channel, 0 for "0"
+// and -1 if there is no valid source
+int ChannelRouting::parseSource(const char *&text) const
+{
+	text = skipSpaces(text);
+
+	bool sidechain = *text == 's' || *text == 'S';
+	if (sidechain) {
+		text++;
+	}
+
+	int channel = parseChannel(text);
+	if (channel < 0 || channel > (sidechain ? numSidechain : numChannels) || (sidechain && channel == 0)) {
+		return -1;
+	}
+	if (channel == 0) {
+		return 0;
+	}
+	return 1 << (channel - 1 + (sidechain ? ROUTING_SIDECHAIN : 0));
+}
+
+bool ChannelRouting::parseInputs(const char *spec)
+{
+	const char *text = skipSpaces(spec);
+
+	// Straight through, with the sidechain channels behind the source's own
+	if (!*text) {
+		numInputs = 0;
+		for (int channel = 0; channel < numChannels; channel++) {
+			inputSources[numInputs] = 1u << channel;
+			inputGains[numInputs++] = 1.0f;
+		}
+		for (int channel = 0; channel < numSidechain && numInputs < ROUTING_MAX_CHANNELS; channel++) {
+			inputSources[numInputs] = 1u << (ROUTING_SIDECHAIN + channel);
+			inputGains[numInputs++] = 1.0f;
+		}
+		return true;
+	}
+
+	numInputs = 0;
+	for (;;) {
+		if (numInputs == ROUTING_MAX_CHANNELS) {
+			return false;
+		}
+
+		uint32_t sources = 0;
+		int      source  = parseSource(text);
+		if (source < 0) {
+			return false;
+		}
+		// 0 alone feeds silence
+		while (source > 0) {
+			sources |= (uint32_t)source;
+			if (*text != '+') {
+				break;
+			}
+			text++;
+			source = parseSource(text);
+			if (source <= 0) {
+				return false;
+			}
+		}
+
+		int count = 0;
+		for (uint32_t bits = sources; bits; bits &= bits - 1) {
+			count++;
+		}
+
+		inputSources[numInputs] = sources;
+		inputGains[numInputs]   = count ? 1.0f / count : 0.0f;
+		numInputs++;
+
+		if (!*text) {
+			return true;
+		}
+		if (*text != ',') {
+			return false;
+		}
+		text++;
+	}
+}
+
+bool ChannelRouting::parseOutputs(const char *spec)
+{
+	const char *text = skipSpaces(spec);
+
+	if (!*text) {
+		for (int channel = 0; channel < ROUTING_MAX_CHANNELS; channel++) {
+			outputSources[channel] = channel < numChannels ? channel : ROUTE_DRY;
+		}
+		return true;
+	}
+
+	// Channels past the end of the list stay dry
+	for (int channel = 0; channel < ROUTING_MAX_CHANNELS; channel++) {
+		outputSources[channel] = ROUTE_DRY;
+	}
+
+	for (int channel = 0;; channel++) {
+		if (channel == numChannels) {
+			return false;
+		}
+
+		if (*text == '-') {
+			text = skipSpaces(text + 1);
+		} else {
+			int output = parseChannel(text);
+			if (output < 0) {
+				return false;
+			}
+			outputSources[channel] = output ? output - 1 : ROUTE_SILENT;
+		}
+
+		if (!*text) {
+			return true;
+		}
+		if (*text != ',') {
+			return false;
+		}
+		text++;
+	}
+}
+
+void ChannelRouting::updateSummary()
+{
+	numOutputs         = 0;
+	numSidechainInputs = 0;
+	passthrough        = numInputs == numChannels;
+
+	for (int input = 0; input < numInputs; input++) {
+		passthrough = passthrough && inputSources[input] == 1u << input;
+		if (inputSources[input] >> ROUTING_SIDECHAIN) {
+			numSidechainInputs++;
+		}
+	}
+
+	for (int channel = 0; channel < numChannels; channel++) {
+		int output  = outputSources[channel];
+		passthrough = passthrough && output == channel;
+		if (output >= numOutputs) {
+			numOutputs = output + 1;
+		}
+	}
+}
+
+void ChannelRouting::limit(int pluginInputs, int pluginOutputs)
+{
+	if (numInputs > pluginInputs) {
+		numInputs = pluginInputs;
+	}
+
+	for (int channel = 0; channel < numChannels; channel++) {
+		if (outputSources[channel] >= pluginOutputs) {
+			outputSources[channel] = ROUTE_DRY;
+		}
+	}
+
+	updateSummary();
+}
+
+void ChannelRouting::routeInputs(float *const *channels, float **mixes, float **in, int frames) const
+{
+	for (int input = 0; input < numInputs; input++) {
+		const float *sources[2 * ROUTING_MAX_CHANNELS];
+		int          numSources = 0;
+		int          last       = 0;
+
+		for (int channel = 0; channel < 2 * ROUTING_MAX_CHANNELS; channel++) {
+			if (inputSources[input] & (1u << channel)) {
+				sources[numSources++] = channels[channel];
+				last                  = channel;
+			}
+		}
+
+		if (numSources == 1) {
+			in[input] = channels[last];
+		} else if (numSources > 1) {
+			simdMix(mixes[input], sources, numSources, inputGains[input], frames);
+			in[input] = mixes[input];
+		}
+	}
+}
+
+void ChannelRouting::routeOutputs(float *const *out, float *const *obs, int frames, LevelMeter *meter) const
+{
+	for (int channel = 0; channel < numChannels; channel++) {
+		if (!obs[channel]) {
+			continue;
+		}
+
+		int output = outputSources[channel];
+		if (meter) {
+			const float *source = output >= 0 ? out[output] : output == ROUTE_SILENT ? nullptr : obs[channel];
+			meter->copy(channel, obs[channel], source, frames);
+		} else if (output >= 0) {
+			memcpy(obs[channel], out[output], frames * sizeof(float));
+		} else if (output == ROUTE_SILENT) {
+			memset(obs[channel], 0, frames * sizeof(float));
+		}
+	}
+
+	if (meter) {
+		meter->advance(frames);
+	}
+}
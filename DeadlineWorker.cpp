@@ -0,0 +1,120 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "headers/DeadlineWorker.h"
+
+#include <chrono>
+
+DeadlineWorker::~DeadlineWorker()
+{
+	stop();
+}
+
+void DeadlineWorker::start(Job job, void *param)
+{
+	if (started) {
+		return;
+	}
+
+	this->job   = job;
+	this->param = param;
+	stopping    = false;
+	started     = true;
+	thread      = std::thread(&DeadlineWorker::loop, this);
+}
+
+void DeadlineWorker::stop()
+{
+	if (!started) {
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		jobDone.wait(guard, [this] { return !pending && !busy; });
+		stopping = true;
+	}
+	wakeWorker.notify_one();
+
+	thread.join();
+	started = false;
+}
+
+void DeadlineWorker::loop()
+{
+	std::unique_lock<std::mutex> guard(lock);
+
+	for (;;) {
+		wakeWorker.wait(guard, [this] { return pending || stopping; });
+		if (stopping) {
+			return;
+		}
+
+		pending = false;
+		busy    = true;
+
+		guard.unlock();
+		job(param);
+		guard.lock();
+
+		busy = false;
+		jobDone.notify_all();
+	}
+}
+
+bool DeadlineWorker::isBusy()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return pending || busy;
+}
+
+bool DeadlineWorker::post()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (pending || busy) {
+			return false;
+		}
+		pending = true;
+	}
+
+	wakeWorker.notify_one();
+	return true;
+}
+
+DeadlineWorker::Result DeadlineWorker::run(uint64_t timeoutNs)
+{
+	if (!post()) {
+		return Busy;
+	}
+
+	std::unique_lock<std::mutex> guard(lock);
+
+	bool finished =
+	        jobDone.wait_for(guard, std::chrono::nanoseconds(timeoutNs), [this] { return !pending && !busy; });
+	return finished ? Finished : Missed;
+}
+
+void DeadlineWorker::waitIdle()
+{
+	if (!started) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> guard(lock);
+	jobDone.wait(guard, [this] { return !pending && !busy; });
+}
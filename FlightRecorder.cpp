@@ -0,0 +1,387 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "headers/FlightRecorder.h"
+#include "headers/WavFile.h"
+#include "headers/vst-simd.hpp"
+
+#include <obs-module.h>
+#include <util/bmem.h>
+#include <util/platform.h>
+
+#include <ctype.h>
+#include <string.h>
+#include <time.h>
+
+static const char *reasonNames[] = {"manual", "invalid-output", "deadline-miss"};
+
+FlightRecorder::~FlightRecorder()
+{
+	stop();
+	freeBuffers();
+}
+
+void FlightRecorder::stop()
+{
+	if (!thread.joinable()) {
+		return;
+	}
+
+	stopping = true;
+	os_sem_post(wake);
+	thread.join();
+
+	os_sem_destroy(wake);
+	wake     = nullptr;
+	stopping = false;
+}
+
+void FlightRecorder::freeBuffers()
+{
+	freePlanes(inputRing, numChannels);
+	freePlanes(outputRing, numChannels);
+	free(passes);
+	free(snapshots);
+	free(snapshotPass);
+	free(snapshotParams);
+
+	passes         = nullptr;
+	snapshots      = nullptr;
+	snapshotPass   = nullptr;
+	snapshotParams = nullptr;
+	capacity       = 0;
+}
+
+void FlightRecorder::configure(int seconds, int numChannels, uint32_t sampleRate)
+{
+	if (seconds < 0) {
+		seconds = 0;
+	} else if (seconds > FLIGHT_RECORDER_MAX_SECONDS) {
+		seconds = FLIGHT_RECORDER_MAX_SECONDS;
+	}
+
+	if (seconds == this->seconds && numChannels == this->numChannels && sampleRate == this->sampleRate) {
+		return;
+	}
+
+	stop();
+	freeBuffers();
+
+	this->seconds     = seconds;
+	this->numChannels = numChannels < FLIGHT_RECORDER_MAX_CHANNELS ? numChannels : FLIGHT_RECORDER_MAX_CHANNELS;
+	this->sampleRate  = sampleRate;
+
+	written          = 0;
+	passesWritten    = 0;
+	snapshotsWritten = 0;
+
+	if (!seconds || this->numChannels <= 0) {
+		return;
+	}
+
+	capacity         = seconds * (int)sampleRate;
+	passCapacity     = capacity / FLIGHT_RECORDER_PASS_FRAMES + 16;
+	snapshotCapacity = passCapacity / FLIGHT_RECORDER_SNAPSHOT_PASSES + 1;
+
+	inputRing      = allocPlanes(this->numChannels, capacity);
+	outputRing     = allocPlanes(this->numChannels, capacity);
+	passes         = (PassInfo *)calloc(passCapacity, sizeof(PassInfo));
+	snapshots      = (float *)calloc((size_t)snapshotCapacity * FLIGHT_RECORDER_MAX_PARAMS, sizeof(float));
+	snapshotPass   = (uint64_t *)calloc(snapshotCapacity, sizeof(uint64_t));
+	snapshotParams = (int *)calloc(snapshotCapacity, sizeof(int));
+
+	os_sem_init(&wake, 0);
+	thread = std::thread(&FlightRecorder::loop, this);
+
+	blog(LOG_INFO,
+	     "VST Plug-in: flight recorder keeps %d s, using %.1f MB",
+	     seconds,
+	     getMemoryUsage() / (1024.0 * 1024.0));
+}
+
+void FlightRecorder::setLabel(const char *label)
+{
+	std::lock_guard<std::mutex> lock(labelLock);
+	this->label = label ? label : "";
+}
+
+size_t FlightRecorder::getMemoryUsage() const
+{
+	return (size_t)capacity * numChannels * 2 * sizeof(float) + (size_t)passCapacity * sizeof(PassInfo) +
+	       (size_t)snapshotCapacity * (FLIGHT_RECORDER_MAX_PARAMS * sizeof(float) + sizeof(uint64_t) + sizeof(int));
+}
+
+static void copyToRing(float **ring, float *const *planes, int numChannels, int capacity, int pos, int frames)
+{
+	int first = frames < capacity - pos ? frames : capacity - pos;
+
+	for (int channel = 0; channel < numChannels; channel++) {
+		if (planes[channel]) {
+			memcpy(ring[channel] + pos, planes[channel], first * sizeof(float));
+			memcpy(ring[channel], planes[channel] + first, (frames - first) * sizeof(float));
+		} else {
+			memset(ring[channel] + pos, 0, first * sizeof(float));
+			memset(ring[channel], 0, (frames - first) * sizeof(float));
+		}
+	}
+}
+
+void FlightRecorder::record(float *const *in, float *const *out, const PassInfo &info, AEffect *effect)
+{
+	if (!capacity || (int)info.frames > capacity) {
+		return;
+	}
+
+	// The dump thread sets frozen and then waits for writing to clear
+	writing.store(true);
+	if (frozen.load()) {
+		writing.store(false);
+		return;
+	}
+
+	int pos = (int)(written % capacity);
+	copyToRing(inputRing, in, numChannels, capacity, pos, info.frames);
+	copyToRing(outputRing, out, numChannels, capacity, pos, info.frames);
+
+	PassInfo &pass = passes[passesWritten % passCapacity];
+	pass           = info;
+	pass.position  = written;
+
+	if (effect && passesWritten % FLIGHT_RECORDER_SNAPSHOT_PASSES == 0) {
+		int    slot   = (int)(snapshotsWritten % snapshotCapacity);
+		int    count  = effect->numParams;
+		float *values = snapshots + (size_t)slot * FLIGHT_RECORDER_MAX_PARAMS;
+
+		if (count > FLIGHT_RECORDER_MAX_PARAMS) {
+			count = FLIGHT_RECORDER_MAX_PARAMS;
+		}
+
+		for (int i = 0; i < count; i++) {
+			values[i] = effect->getParameter(effect, i);
+		}
+		snapshotParams[slot] = count;
+		snapshotPass[slot]   = passesWritten;
+		snapshotsWritten++;
+	}
+
+	written += info.frames;
+	passesWritten++;
+
+	writing.store(false);
+}
+
+void FlightRecorder::requestDump(Reason reason)
+{
+	if (!capacity) {
+		return;
+	}
+
+	if (reason != Manual) {
+		uint64_t now  = os_gettime_ns();
+		uint64_t last = lastAutoDump;
+		if (last && now - last < FLIGHT_RECORDER_AUTO_INTERVAL_NS) {
+			return;
+		}
+		if (!lastAutoDump.compare_exchange_strong(last, now)) {
+			return;
+		}
+	}
+
+	// Only one dump is pending at a time, later requests fold into it
+	int expected = -1;
+	if (pendingReason.compare_exchange_strong(expected, (int)reason)) {
+		os_sem_post(wake);
+	}
+}
+
+void FlightRecorder::loop()
+{
+	os_set_thread_name("vst-flight-recorder");
+
+	for (;;) {
+		os_sem_wait(wake);
+		if (stopping) {
+			return;
+		}
+
+		int reason = pendingReason.exchange(-1);
+		if (reason >= 0) {
+			dump((Reason)reason);
+		}
+	}
+}
+
+void FlightRecorder::dump(Reason reason)
+{
+	// Keep recording a little so the dump shows what happened afterwards too
+	os_sleep_ms(FLIGHT_RECORDER_POST_TRIGGER_MS);
+
+	frozen.store(true);
+	while (writing.load()) {
+		std::this_thread::yield();
+	}
+
+	uint64_t end   = written;
+	uint64_t start = end > (uint64_t)capacity ? end - capacity : 0;
+
+	std::string name;
+	{
+		std::lock_guard<std::mutex> lock(labelLock);
+		name = label.empty() ? "vst" : label;
+	}
+	for (char &c : name) {
+		if (!isalnum((unsigned char)c)) {
+			c = '_';
+		}
+	}
+
+	char      stamp[32];
+	time_t    now = time(nullptr);
+	struct tm local;
+#ifdef _WIN32
+	localtime_s(&local, &now);
+#else
+	localtime_r(&now, &local);
+#endif
+	strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local);
+
+	std::string base = name + "-" + stamp + "-" + reasonNames[reason];
+
+	char *directory = obs_module_config_path("flight-recorder");
+	os_mkdirs(directory);
+	std::string path = std::string(directory) + "/" + base;
+	bfree(directory);
+
+	WavWriter wav;
+	bool      success = wav.open((path + ".wav").c_str(), numChannels * 2, sampleRate);
+
+	// At most two contiguous pieces, the ring may wrap once
+	for (uint64_t position = start; success && position < end;) {
+		int pos    = (int)(position % capacity);
+		int frames = (int)(end - position < (uint64_t)(capacity - pos) ? end - position : capacity - pos);
+
+		const float *planes[2 * FLIGHT_RECORDER_MAX_CHANNELS];
+		for (int channel = 0; channel < numChannels; channel++) {
+			planes[channel]               = inputRing[channel] + pos;
+			planes[numChannels + channel] = outputRing[channel] + pos;
+		}
+		position += frames;
+
+		success = wav.write(planes, frames);
+	}
+	success &= wav.close();
+
+	FILE *json = os_fopen((path + ".json").c_str(), "w");
+	if (json) {
+		writeJson(json, reason, base + ".wav", start, end);
+		success &= fclose(json) == 0;
+	} else {
+		success = false;
+	}
+
+	frozen.store(false);
+	dumps++;
+
+	if (success) {
+		blog(LOG_INFO, "VST Plug-in: flight recorder dumped to '%s'", path.c_str());
+	} else {
+		blog(LOG_WARNING, "VST Plug-in: flight recorder failed to write '%s'", path.c_str());
+	}
+}
+
+static void writeJsonString(FILE *file, const char *text)
+{
+	fputc('"', file);
+	for (const char *c = text; *c; c++) {
+		if (*c == '"' || *c == '\\') {
+			fprintf(file, "\\%c", *c);
+		} else if ((unsigned char)*c < 0x20) {
+			fprintf(file, "\\u%04x", (unsigned char)*c);
+		} else {
+			fputc(*c, file);
+		}
+	}
+	fputc('"', file);
+}
+
+void FlightRecorder::writeJson(FILE *file, Reason reason, const std::string &wavName, uint64_t start, uint64_t end)
+{
+	fprintf(file, "{\n\t\"plugin\": ");
+	{
+		std::lock_guard<std::mutex> lock(labelLock);
+		writeJsonString(file, label.c_str());
+	}
+	fprintf(file, ",\n\t\"reason\": \"%s\",\n\t\"wav\": ", reasonNames[reason]);
+	writeJsonString(file, wavName.c_str());
+	fprintf(file,
+	        ",\n\t\"sampleRate\": %u,\n\t\"channels\": %d,\n"
+	        "\t\"layout\": \"inputs first, then outputs\",\n\t\"frames\": %llu,\n\t\"passes\": [",
+	        sampleRate,
+	        numChannels,
+	        (unsigned long long)(end - start));
+
+	uint64_t first     = passesWritten > (uint64_t)passCapacity ? passesWritten - passCapacity : 0;
+	uint64_t included  = passesWritten;
+	bool     separator = false;
+
+	for (uint64_t n = first; n < passesWritten; n++) {
+		const PassInfo &pass = passes[n % passCapacity];
+		if (pass.position < start) {
+			continue;
+		}
+		if (included == passesWritten) {
+			included = n;
+		}
+
+		fprintf(file,
+		        "%s\n\t\t{\"pass\": %llu, \"offset\": %llu, \"frames\": %u, \"timestamp\": %llu, "
+		        "\"processNs\": %llu, \"invalid\": %u, \"missed\": %s}",
+		        separator ? "," : "",
+		        (unsigned long long)n,
+		        (unsigned long long)(pass.position - start),
+		        pass.frames,
+		        (unsigned long long)pass.timestamp,
+		        (unsigned long long)pass.processTime,
+		        pass.invalid,
+		        pass.missed ? "true" : "false");
+		separator = true;
+	}
+
+	fprintf(file, "\n\t],\n\t\"parameters\": [");
+
+	uint64_t firstSnapshot = snapshotsWritten > (uint64_t)snapshotCapacity ? snapshotsWritten - snapshotCapacity : 0;
+	separator              = false;
+
+	for (uint64_t n = firstSnapshot; n < snapshotsWritten; n++) {
+		int slot = (int)(n % snapshotCapacity);
+		if (snapshotPass[slot] < included) {
+			continue;
+		}
+
+		fprintf(file,
+		        "%s\n\t\t{\"pass\": %llu, \"values\": [",
+		        separator ? "," : "",
+		        (unsigned long long)snapshotPass[slot]);
+		for (int i = 0; i < snapshotParams[slot]; i++) {
+			fprintf(file, "%s%g", i ? ", " : "", snapshots[(size_t)slot * FLIGHT_RECORDER_MAX_PARAMS + i]);
+		}
+		fprintf(file, "]}");
+		separator = true;
+	}
+
+	fprintf(file, "\n\t]\n}\n");
+}
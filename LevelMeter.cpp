@@ -0,0 +1,242 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "headers/LevelMeter.h"
+#include "headers/vst-simd.hpp"
+
+#include <string.h>
+
+static float toDecibels(double power)
+{
+	return power > 0.0 ? (float)(10.0 * log10(power)) : -INFINITY;
+}
+
+/*
+ * Both K-weighting stages in transposed direct form II, returns the squared
+ * weighted sample. Double precision, the high-pass poles sit very close to
+ * the unit circle.
+ */
+inline double LevelMeter::weightedSquare(double x, const Biquad &shelf, const Biquad &highPass, double *z)
+{
+	double y = shelf.b0 * x + z[0];
+	z[0]     = shelf.b1 * x - shelf.a1 * y + z[1];
+	z[1]     = shelf.b2 * x - shelf.a2 * y;
+
+	double w = highPass.b0 * y + z[2];
+	z[2]     = highPass.b1 * y - highPass.a1 * w + z[3];
+	z[3]     = highPass.b2 * y - highPass.a2 * w;
+	return w * w;
+}
+
+LevelMeter::LevelMeter()
+{
+	configure(48000, 2);
+}
+
+void LevelMeter::configure(uint32_t sampleRate, int numChannels)
+{
+	this->numChannels = numChannels < LEVEL_METER_MAX_CHANNELS ? numChannels : LEVEL_METER_MAX_CHANNELS;
+	blockLength       = sampleRate / 10;
+
+	// BS.1770 pre-filter, redesigned for the actual rate
+	double k  = tan(M_PI * 1681.974450955533 / sampleRate);
+	double vh = pow(10.0, 3.999843853973347 / 20.0);
+	double vb = pow(vh, 0.4996667741545416);
+	double q  = 0.7071752369554196;
+	double a0 = 1.0 + k / q + k * k;
+
+	shelf.b0 = (vh + vb * k / q + k * k) / a0;
+	shelf.b1 = 2.0 * (k * k - vh) / a0;
+	shelf.b2 = (vh - vb * k / q + k * k) / a0;
+	shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+	shelf.a2 = (1.0 - k / q + k * k) / a0;
+
+	// RLB high-pass
+	k  = tan(M_PI * 38.13547087602444 / sampleRate);
+	q  = 0.5003270373238773;
+	a0 = 1.0 + k / q + k * k;
+
+	highPass.b0 = 1.0;
+	highPass.b1 = -2.0;
+	highPass.b2 = 1.0;
+	highPass.a1 = 2.0 * (k * k - 1.0) / a0;
+	highPass.a2 = (1.0 - k / q + k * k) / a0;
+
+	// OBS channel order, LFE is left out and surrounds count 1.41 times
+	for (int channel = 0; channel < LEVEL_METER_MAX_CHANNELS; channel++) {
+		weights[channel] = 1.0f;
+	}
+	if (numChannels == 3) {
+		weights[2] = 0.0f;
+	} else if (numChannels == 4) {
+		weights[3] = 1.41f;
+	} else if (numChannels >= 5) {
+		weights[3] = 0.0f;
+		for (int channel = 4; channel < this->numChannels; channel++) {
+			weights[channel] = 1.41f;
+		}
+	}
+
+	reset();
+}
+
+void LevelMeter::reset()
+{
+	memset(filterState, 0, sizeof(filterState));
+	memset(&current, 0, sizeof(current));
+	memset(blocks, 0, sizeof(blocks));
+	blockPos = 0;
+
+	for (int signal = 0; signal < Signals; signal++) {
+		peak[signal]     = -INFINITY;
+		rms[signal]      = -INFINITY;
+		loudness[signal] = -INFINITY;
+	}
+}
+
+void LevelMeter::copy(int channel, float *dst, const float *src, int frames)
+{
+	if (channel >= numChannels) {
+		if (!src) {
+			memset(dst, 0, frames * sizeof(float));
+		} else if (src != dst) {
+			memcpy(dst, src, frames * sizeof(float));
+		}
+		return;
+	}
+
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+	__m128 inputPeak      = _mm_setzero_ps();
+	__m128 outputPeak     = _mm_setzero_ps();
+	__m128 inputSquares   = _mm_setzero_ps();
+	__m128 outputSquares  = _mm_setzero_ps();
+	double inputWeighted  = 0.0;
+	double outputWeighted = 0.0;
+
+	double *inputState  = filterState[channel][Input];
+	double *outputState = filterState[channel][Output];
+
+	int i      = 0;
+	int vector = frames & ~3;
+
+	for (; i < vector; i += 4) {
+		__m128 x = _mm_loadu_ps(dst + i);
+		__m128 y = src ? _mm_loadu_ps(src + i) : _mm_setzero_ps();
+		_mm_storeu_ps(dst + i, y);
+
+		inputPeak     = _mm_max_ps(inputPeak, _mm_and_ps(x, absMask));
+		outputPeak    = _mm_max_ps(outputPeak, _mm_and_ps(y, absMask));
+		inputSquares  = _mm_add_ps(inputSquares, _mm_mul_ps(x, x));
+		outputSquares = _mm_add_ps(outputSquares, _mm_mul_ps(y, y));
+
+		// The weighting filters are recursive, they run per sample
+		float in[4];
+		float out[4];
+		_mm_storeu_ps(in, x);
+		_mm_storeu_ps(out, y);
+		for (int j = 0; j < 4; j++) {
+			inputWeighted += weightedSquare(in[j], shelf, highPass, inputState);
+			outputWeighted += weightedSquare(out[j], shelf, highPass, outputState);
+		}
+	}
+
+	float lanes[4];
+	_mm_storeu_ps(lanes, inputPeak);
+	float inPeak = fmaxf(fmaxf(lanes[0], lanes[1]), fmaxf(lanes[2], lanes[3]));
+	_mm_storeu_ps(lanes, outputPeak);
+	float outPeak = fmaxf(fmaxf(lanes[0], lanes[1]), fmaxf(lanes[2], lanes[3]));
+	_mm_storeu_ps(lanes, inputSquares);
+	double inSquares = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+	_mm_storeu_ps(lanes, outputSquares);
+	double outSquares = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+	for (; i < frames; i++) {
+		float x = dst[i];
+		float y = src ? src[i] : 0.0f;
+		dst[i]  = y;
+
+		inPeak  = fmaxf(inPeak, fabsf(x));
+		outPeak = fmaxf(outPeak, fabsf(y));
+		inSquares += x * x;
+		outSquares += y * y;
+		inputWeighted += weightedSquare(x, shelf, highPass, inputState);
+		outputWeighted += weightedSquare(y, shelf, highPass, outputState);
+	}
+
+	current.peak[Input]  = fmaxf(current.peak[Input], inPeak);
+	current.peak[Output] = fmaxf(current.peak[Output], outPeak);
+	current.squares[Input] += inSquares;
+	current.squares[Output] += outSquares;
+	current.loudness[Input] += weights[channel] * inputWeighted;
+	current.loudness[Output] += weights[channel] * outputWeighted;
+	current.samples[Input] += frames;
+	current.samples[Output] += frames;
+}
+
+void LevelMeter::advance(int frames)
+{
+	current.frames += frames;
+	if (current.frames < blockLength) {
+		return;
+	}
+
+	blocks[blockPos] = current;
+	blockPos         = (blockPos + 1) % LEVEL_METER_BLOCKS;
+	memset(&current, 0, sizeof(current));
+
+	publish();
+}
+
+void LevelMeter::publish()
+{
+	for (int signal = 0; signal < Signals; signal++) {
+		float    maximum  = 0.0f;
+		double   weighted = 0.0;
+		uint64_t frames   = 0;
+		double   squares  = 0.0;
+		uint64_t samples  = 0;
+
+		for (int block = 0; block < LEVEL_METER_BLOCKS; block++) {
+			maximum = fmaxf(maximum, blocks[block].peak[signal]);
+			weighted += blocks[block].loudness[signal];
+			frames += blocks[block].frames;
+		}
+
+		// The newest blocks, just before blockPos
+		for (int block = 1; block <= LEVEL_METER_RMS_BLOCKS; block++) {
+			const Block &recent = blocks[(blockPos + LEVEL_METER_BLOCKS - block) % LEVEL_METER_BLOCKS];
+			squares += recent.squares[signal];
+			samples += recent.samples[signal];
+		}
+
+		peak[signal]     = toDecibels((double)maximum * maximum);
+		rms[signal]      = toDecibels(samples ? squares / samples : 0.0);
+		loudness[signal] = frames ? -0.691f + toDecibels(weighted / frames) : -INFINITY;
+	}
+}
+
+LevelMeter::Levels LevelMeter::getInput() const
+{
+	return {peak[Input], rms[Input], loudness[Input]};
+}
+
+LevelMeter::Levels LevelMeter::getOutput() const
+{
+	return {peak[Output], rms[Output], loudness[Output]};
+}
@@ -0,0 +1,170 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "headers/LinkedInstances.h"
+#include "headers/VSTPlugin.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <vector>
+
+struct LinkedInstance {
+	VSTPlugin *                 plugin = nullptr;
+	std::vector<obs_source_t *> filters;
+	std::vector<obs_source_t *> running;
+};
+
+static std::mutex                            instancesLock;
+static std::map<std::string, LinkedInstance> instances;
+
+static std::map<std::string, LinkedInstance>::iterator findInstance(VSTPlugin *plugin)
+{
+	for (auto entry = instances.begin(); entry != instances.end(); ++entry) {
+		if (entry->second.plugin == plugin) {
+			return entry;
+		}
+	}
+	return instances.end();
+}
+
+VSTPlugin *acquireLinkedInstance(const std::string &path,
+                                 const std::string &linkId,
+                                 obs_source_t *     filter,
+                                 bool &             created)
+{
+	std::lock_guard<std::mutex> lock(instancesLock);
+
+	LinkedInstance &instance = instances[path + '\n' + linkId];
+
+	created = !instance.plugin;
+	if (created) {
+		instance.plugin = new VSTPlugin(filter);
+		// Suspended until one of the filters runs
+		instance.plugin->setEnabled(false);
+		blog(LOG_INFO, "VST Plug-in: new linked instance of '%s' (link '%s')", path.c_str(), linkId.c_str());
+	}
+
+	instance.filters.push_back(filter);
+	return instance.plugin;
+}
+
+// Called with instancesLock held
+static void updateLiveFilter(LinkedInstance &instance)
+{
+	instance.plugin->liveFilter = instance.running.empty() ? nullptr : instance.running.front();
+	instance.plugin->setEnabled(!instance.running.empty());
+}
+
+obs_source_t *releaseLinkedInstance(VSTPlugin *plugin, obs_source_t *filter)
+{
+	std::lock_guard<std::mutex> lock(instancesLock);
+
+	auto entry = findInstance(plugin);
+	if (entry == instances.end()) {
+		return nullptr;
+	}
+
+	LinkedInstance &instance = entry->second;
+	instance.filters.erase(std::remove(instance.filters.begin(), instance.filters.end(), filter),
+	                       instance.filters.end());
+
+	if (instance.filters.empty()) {
+		QMetaObject::invokeMethod(plugin, "closeEditor");
+		plugin->deleteLater();
+		instances.erase(entry);
+		return nullptr;
+	}
+
+	auto running = std::find(instance.running.begin(), instance.running.end(), filter);
+	if (running != instance.running.end()) {
+		instance.running.erase(running);
+		updateLiveFilter(instance);
+	}
+
+	// The editor title, names and processing options follow one of the remaining filters
+	if (plugin->getSourceContext() != filter) {
+		return nullptr;
+	}
+	plugin->setSourceContext(instance.filters.front());
+	return instance.filters.front();
+}
+
+void setLinkedInstanceRunning(VSTPlugin *plugin, obs_source_t *filter, bool running)
+{
+	std::lock_guard<std::mutex> lock(instancesLock);
+
+	auto entry = findInstance(plugin);
+	if (entry == instances.end()) {
+		return;
+	}
+
+	LinkedInstance &instance = entry->second;
+	instance.running.erase(std::remove(instance.running.begin(), instance.running.end(), filter),
+	                       instance.running.end());
+	if (running) {
+		instance.running.push_back(filter);
+	}
+
+	if (running && instance.running.size() == 2) {
+		blog(LOG_WARNING,
+		     "VST Plug-in: several filters linked to one instance are live, "
+		     "only '%s' is processed and the others pass their audio through",
+		     obs_source_get_name(instance.running.front()));
+	}
+
+	updateLiveFilter(instance);
+}
+
+std::string linkedInstanceStatus(VSTPlugin *plugin, obs_source_t *filter)
+{
+	std::lock_guard<std::mutex> lock(instancesLock);
+
+	auto entry = findInstance(plugin);
+	if (entry == instances.end()) {
+		return "";
+	}
+
+	LinkedInstance &instance = entry->second;
+	bool            running  = std::count(instance.running.begin(), instance.running.end(), filter) > 0;
+
+	char line[256];
+	if (instance.running.empty()) {
+		snprintf(line,
+		         sizeof(line),
+		         "Linked instance: suspended, shared by %d filters\n",
+		         (int)instance.filters.size());
+	} else if (instance.running.front() == filter) {
+		snprintf(line,
+		         sizeof(line),
+		         "Linked instance: processing this filter, shared by %d filters\n",
+		         (int)instance.filters.size());
+	} else if (running) {
+		// Live as well, but the instance only processes one filter's audio
+		snprintf(line,
+		         sizeof(line),
+		         "Linked instance: busy with '%s', this filter passes its audio through\n",
+		         obs_source_get_name(instance.running.front()));
+	} else {
+		snprintf(line,
+		         sizeof(line),
+		         "Linked instance: processing '%s'\n",
+		         obs_source_get_name(instance.running.front()));
+	}
+	return line;
+}
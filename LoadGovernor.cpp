@@ -0,0 +1,188 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "headers/LoadGovernor.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+static std::mutex                    filtersLock;
+static std::vector<GovernedFilter *> filters;
+static int                           budget = 0;
+
+static std::atomic<uint64_t> windowStart{0};
+static std::atomic<uint64_t> totalTime{0};
+static std::atomic<uint64_t> moduleLoad{0};
+static uint64_t              lastChange = 0;
+
+void governorInit()
+{
+	const char *value = getenv("OBS_VST_LOAD_BUDGET");
+	if (value && *value) {
+		budget = atoi(value);
+		budget = budget > 0 ? budget : 0;
+	}
+
+	if (budget) {
+		blog(LOG_INFO, "VST Plug-in: load shedding above %d%% of real time", budget);
+	}
+}
+
+void governorAdd(GovernedFilter *filter)
+{
+	std::lock_guard<std::mutex> lock(filtersLock);
+	filters.push_back(filter);
+}
+
+void governorRemove(GovernedFilter *filter)
+{
+	std::lock_guard<std::mutex> lock(filtersLock);
+	filters.erase(std::remove(filters.begin(), filters.end(), filter), filters.end());
+}
+
+static void logChange(const char *action, GovernedFilter *filter, uint64_t load)
+{
+	obs_source_t *target = obs_filter_get_target(filter->context);
+
+	blog(LOG_WARNING,
+	     "VST Plug-in: VST filters at %.1f%% of real time, budget %d%%, %s '%s' on '%s'",
+	     load / 10.0,
+	     budget,
+	     action,
+	     obs_source_get_name(filter->context),
+	     target ? obs_source_get_name(target) : "");
+}
+
+// Called with filtersLock held by the thread that completed the window
+static void evaluate(uint64_t load, uint64_t now)
+{
+	uint64_t limit = (uint64_t)budget * 10;
+
+	for (GovernedFilter *filter : filters) {
+		// Taken out of shedding by the user
+		if (filter->shed && filter->priority <= 0) {
+			filter->shed = false;
+		}
+	}
+
+	if (load > limit) {
+		GovernedFilter *victim = nullptr;
+		for (GovernedFilter *filter : filters) {
+			if (filter->shed || filter->priority <= 0) {
+				continue;
+			}
+			if (!victim || filter->priority < victim->priority ||
+			    (filter->priority == victim->priority && filter->load > victim->load)) {
+				victim = filter;
+			}
+		}
+
+		if (victim) {
+			victim->shedLoad = victim->load;
+			victim->shed     = true;
+			victim->sheds++;
+			lastChange = now;
+			logChange("bypassing", victim, load);
+		}
+		return;
+	}
+
+	if (now - lastChange < GOVERNOR_HOLD_MS * 1000000ULL) {
+		return;
+	}
+
+	GovernedFilter *candidate = nullptr;
+	for (GovernedFilter *filter : filters) {
+		if (!filter->shed) {
+			continue;
+		}
+		if (!candidate || filter->priority > candidate->priority ||
+		    (filter->priority == candidate->priority && filter->shedLoad < candidate->shedLoad)) {
+			candidate = filter;
+		}
+	}
+
+	if (candidate && (load + candidate->shedLoad) * 100 < limit * GOVERNOR_RESTORE_MARGIN) {
+		candidate->shed = false;
+		lastChange      = now;
+		logChange("restoring", candidate, load);
+	}
+}
+
+void governorAccount(GovernedFilter *filter, uint64_t start, uint64_t end)
+{
+	filter->time += end - start;
+	totalTime += end - start;
+
+	uint64_t began = windowStart.load();
+	if (end - began < GOVERNOR_WINDOW_MS * 1000000ULL) {
+		return;
+	}
+
+	// Whoever moves the window on evaluates it, everybody else carries on
+	if (!windowStart.compare_exchange_strong(began, end)) {
+		return;
+	}
+
+	uint64_t window = end - began;
+	uint64_t load   = totalTime.exchange(0) * 1000 / window;
+	moduleLoad      = load;
+
+	std::unique_lock<std::mutex> lock(filtersLock, std::try_to_lock);
+	if (!lock.owns_lock()) {
+		return;
+	}
+
+	for (GovernedFilter *governed : filters) {
+		governed->load = governed->time.exchange(0) * 1000 / window;
+	}
+
+	if (budget) {
+		evaluate(load, end);
+	}
+}
+
+std::string governorStatus(GovernedFilter *filter)
+{
+	char line[256];
+
+	if (!budget) {
+		return "Load shedding: off\n";
+	}
+
+	snprintf(line,
+	         sizeof(line),
+	         "Load shedding: VST filters at %.1f%% of real time, budget %d%%\n",
+	         moduleLoad / 10.0,
+	         budget);
+	std::string status = line;
+
+	if (filter->priority > 0) {
+		snprintf(line,
+		         sizeof(line),
+		         "Shedding priority %d, bypassed %llu times%s\n",
+		         (int)filter->priority,
+		         (unsigned long long)filter->sheds,
+		         filter->shed ? " (bypassed now)" : "");
+		status += line;
+	}
+	return status;
+}
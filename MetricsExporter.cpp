@@ -0,0 +1,293 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "headers/MetricsExporter.h"
+#include "headers/VSTPlugin.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <QTimer>
+#include <util/platform.h>
+
+struct MetricsEntry {
+	obs_source_t *filter;
+	VSTPlugin *   plugin;
+
+	// Taken at the previous snapshot, for the rates over the interval
+	uint64_t processTime;
+	uint64_t blockTimes[METRICS_BUCKETS];
+};
+
+static std::mutex                entriesLock;
+static std::vector<MetricsEntry> entries;
+static char *                    metricsPath = nullptr;
+static QTimer *                  timer       = nullptr;
+static uint64_t                  lastWrite   = 0;
+
+void metricsAdd(obs_source_t *filter, VSTPlugin *plugin)
+{
+	std::lock_guard<std::mutex> lock(entriesLock);
+
+	MetricsEntry entry = {};
+	entry.filter       = filter;
+	entry.plugin       = plugin;
+	entries.push_back(entry);
+}
+
+void metricsRemove(obs_source_t *filter)
+{
+	std::lock_guard<std::mutex> lock(entriesLock);
+
+	for (auto it = entries.begin(); it != entries.end(); ++it) {
+		if (it->filter == filter) {
+			entries.erase(it);
+			return;
+		}
+	}
+}
+
+// Label values may hold anything a user names a source
+static std::string escapeLabel(const char *value)
+{
+	std::string escaped;
+	for (const char *c = value ? value : ""; *c; c++) {
+		if (*c == '\\' || *c == '"') {
+			escaped += '\\';
+			escaped += *c;
+		} else if (*c == '\n') {
+			escaped += "\\n";
+		} else {
+			escaped += *c;
+		}
+	}
+	return escaped;
+}
+
+// Upper bound of the bucket holding the given share of the blocks, in seconds
+static double percentile(const uint64_t *counts, double share)
+{
+	uint64_t total = 0;
+	for (int bucket = 0; bucket < METRICS_BUCKETS; bucket++) {
+		total += counts[bucket];
+	}
+	if (!total) {
+		return 0.0;
+	}
+
+	uint64_t rank = (uint64_t)(total * share + 0.5);
+	uint64_t seen = 0;
+	for (int bucket = 0; bucket < METRICS_BUCKETS - 1; bucket++) {
+		seen += counts[bucket];
+		if (seen >= rank) {
+			return ((uint64_t)METRICS_FIRST_BUCKET_US << bucket) / 1e6;
+		}
+	}
+	// Beyond the last bound, report that
+	return ((uint64_t)METRICS_FIRST_BUCKET_US << (METRICS_BUCKETS - 2)) / 1e6;
+}
+
+static void appendHelp(std::string &text, const char *name, const char *type, const char *help)
+{
+	text += "# HELP ";
+	text += name;
+	text += ' ';
+	text += help;
+	text += "\n# TYPE ";
+	text += name;
+	text += ' ';
+	text += type;
+	text += '\n';
+}
+
+static void appendSample(std::string &text, const char *name, const std::string &labels, double value)
+{
+	char number[64];
+	snprintf(number, sizeof(number), " %.9g\n", value);
+
+	text += name;
+	text += '{';
+	text += labels;
+	text += '}';
+	text += number;
+}
+
+static std::string collect(uint64_t now)
+{
+	struct Sample {
+		std::string        labels;
+		VSTPlugin::Metrics metrics;
+		double             load;
+		double             p99;
+	};
+
+	std::vector<Sample> samples;
+	double              interval = lastWrite ? (now - lastWrite) / 1e9 : 0.0;
+
+	{
+		std::lock_guard<std::mutex> lock(entriesLock);
+		samples.resize(entries.size());
+
+		for (size_t index = 0; index < entries.size(); index++) {
+			MetricsEntry &      entry  = entries[index];
+			Sample &            sample = samples[index];
+			VSTPlugin::Metrics &m      = sample.metrics;
+			entry.plugin->getMetrics(m);
+
+			obs_source_t *target = obs_filter_get_target(entry.filter);
+			sample.labels        = "plugin=\"" + escapeLabel(m.name.c_str());
+			sample.labels += "\",source=\"" + escapeLabel(target ? obs_source_get_name(target) : "");
+			sample.labels += "\",filter=\"" + escapeLabel(obs_source_get_name(entry.filter)) + "\"";
+
+			// Rates over the interval since the previous snapshot
+			uint64_t delta[METRICS_BUCKETS];
+			for (int bucket = 0; bucket < METRICS_BUCKETS; bucket++) {
+				delta[bucket]            = m.blockTimes[bucket] - entry.blockTimes[bucket];
+				entry.blockTimes[bucket] = m.blockTimes[bucket];
+			}
+			sample.load       = interval > 0.0 ? (m.processTime - entry.processTime) / 1e9 / interval : 0.0;
+			sample.p99        = percentile(delta, 0.99);
+			entry.processTime = m.processTime;
+		}
+	}
+
+	std::string text;
+	text.reserve(4096 + samples.size() * 2048);
+
+	appendHelp(text, "obs_vst_running", "gauge", "1 while the plug-in processes audio");
+	for (const Sample &sample : samples) {
+		appendSample(text, "obs_vst_running", sample.labels, sample.metrics.running ? 1.0 : 0.0);
+	}
+
+	appendHelp(text, "obs_vst_cpu_load", "gauge", "Seconds spent processing per second, over the last interval");
+	for (const Sample &sample : samples) {
+		appendSample(text, "obs_vst_cpu_load", sample.labels, sample.load);
+	}
+
+	appendHelp(text, "obs_vst_process_seconds_total", "counter", "Time spent processing audio");
+	for (const Sample &sample : samples) {
+		appendSample(text, "obs_vst_process_seconds_total", sample.labels, sample.metrics.processTime / 1e9);
+	}
+
+	appendHelp(text,
+	           "obs_vst_block_p99_seconds",
+	           "gauge",
+	           "99th percentile of the block time over the last interval, as a bucket bound");
+	for (const Sample &sample : samples) {
+		appendSample(text, "obs_vst_block_p99_seconds", sample.labels, sample.p99);
+	}
+
+	appendHelp(text, "obs_vst_block_seconds", "histogram", "Time per block of up to 512 frames");
+	for (const Sample &sample : samples) {
+		const VSTPlugin::Metrics &m     = sample.metrics;
+		uint64_t                  count = 0;
+		for (int bucket = 0; bucket < METRICS_BUCKETS; bucket++) {
+			char bound[32];
+			count += m.blockTimes[bucket];
+			if (bucket < METRICS_BUCKETS - 1) {
+				snprintf(bound, sizeof(bound), "%g", ((uint64_t)METRICS_FIRST_BUCKET_US << bucket) / 1e6);
+			} else {
+				strcpy(bound, "+Inf");
+			}
+			appendSample(text, "obs_vst_block_seconds_bucket", sample.labels + ",le=\"" + bound + "\"", (double)count);
+		}
+		appendSample(text, "obs_vst_block_seconds_sum", sample.labels, m.blockTimeSum / 1e9);
+		appendSample(text, "obs_vst_block_seconds_count", sample.labels, (double)count);
+	}
+
+	appendHelp(text, "obs_vst_overruns_total", "counter", "Blocks that took longer than their own duration");
+	for (const Sample &sample : samples) {
+		appendSample(text, "obs_vst_overruns_total", sample.labels, (double)sample.metrics.overruns);
+	}
+
+	appendHelp(text, "obs_vst_deadline_misses_total", "counter", "Passes abandoned by the deadline watchdog");
+	for (const Sample &sample : samples) {
+		appendSample(text, "obs_vst_deadline_misses_total", sample.labels, (double)sample.metrics.deadlineMisses);
+	}
+
+	appendHelp(text, "obs_vst_latency_seconds", "gauge", "Delay the filter adds to the audio");
+	for (const Sample &sample : samples) {
+		appendSample(text, "obs_vst_latency_seconds", sample.labels, sample.metrics.latency);
+	}
+
+	appendHelp(text, "obs_vst_state_bytes", "gauge", "Size of the plug-in state as last saved or loaded");
+	for (const Sample &sample : samples) {
+		appendSample(text, "obs_vst_state_bytes", sample.labels, (double)sample.metrics.stateSize);
+	}
+
+	appendHelp(text, "obs_vst_host_memory_bytes", "gauge", "Buffers the host holds for the instance");
+	for (const Sample &sample : samples) {
+		appendSample(text, "obs_vst_host_memory_bytes", sample.labels, (double)sample.metrics.hostMemory);
+	}
+
+	return text;
+}
+
+static void writeSnapshot()
+{
+	uint64_t    now  = os_gettime_ns();
+	std::string text = collect(now);
+	lastWrite        = now;
+
+	// Written next to the target and renamed over it
+	std::string temporary = std::string(metricsPath) + ".tmp";
+	FILE *      file      = os_fopen(temporary.c_str(), "wb");
+	if (!file) {
+		return;
+	}
+
+	bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+	written      = fclose(file) == 0 && written;
+	if (!written || os_rename(temporary.c_str(), metricsPath) != 0) {
+		os_unlink(temporary.c_str());
+	}
+}
+
+void metricsInit()
+{
+	const char *path = getenv("OBS_VST_METRICS");
+	if (!path || !*path) {
+		return;
+	}
+
+	metricsPath = strdup(path);
+
+	// Lives on the UI thread, which loads and unloads the plug-ins
+	timer = new QTimer();
+	QObject::connect(timer, &QTimer::timeout, writeSnapshot);
+	timer->start(METRICS_INTERVAL_MS);
+
+	blog(LOG_INFO, "VST Plug-in: writing metrics to '%s'", metricsPath);
+}
+
+void metricsStop()
+{
+	if (!timer) {
+		return;
+	}
+
+	delete timer;
+	timer = nullptr;
+
+	os_unlink(metricsPath);
+	free(metricsPath);
+	metricsPath = nullptr;
+}
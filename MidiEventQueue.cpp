@@ -0,0 +1,100 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "headers/MidiEventQueue.h"
+
+#include <string.h>
+
+MidiEventQueue::MidiEventQueue()
+{
+	memset(pool, 0, sizeof(pool));
+	memset(&block, 0, sizeof(block));
+
+	for (int i = 0; i < MIDI_EVENTS_PER_PASS; i++) {
+		pool[i].type     = kVstMidiType;
+		pool[i].byteSize = sizeof(VstMidiEvent);
+		block.events[i]  = (VstEvent *)&pool[i];
+	}
+}
+
+bool MidiEventQueue::push(uint64_t timestamp, uint8_t status, uint8_t data1, uint8_t data2)
+{
+	std::lock_guard<std::mutex> lock(producerLock);
+
+	uint32_t write = head.load(std::memory_order_relaxed);
+	if (write - tail.load(std::memory_order_acquire) >= MIDI_QUEUE_CAPACITY) {
+		dropped++;
+		return false;
+	}
+
+	Message &message  = ring[write % MIDI_QUEUE_CAPACITY];
+	message.timestamp = timestamp;
+	message.data[0]   = (char)status;
+	message.data[1]   = (char)data1;
+	message.data[2]   = (char)data2;
+
+	head.store(write + 1, std::memory_order_release);
+	return true;
+}
+
+VstEvents *MidiEventQueue::collect(uint64_t start, uint64_t end, int frames)
+{
+	uint32_t read      = tail.load(std::memory_order_relaxed);
+	uint32_t available = head.load(std::memory_order_acquire);
+	int      count     = 0;
+	int      lastFrame = 0;
+
+	while (read != available && count < MIDI_EVENTS_PER_PASS) {
+		const Message &message = ring[read % MIDI_QUEUE_CAPACITY];
+		if (message.timestamp >= end) {
+			break;
+		}
+
+		// Late messages play at the start, offsets must never go backwards
+		int frame = 0;
+		if (message.timestamp > start && end > start) {
+			frame = (int)((message.timestamp - start) * frames / (end - start));
+		}
+		if (frame >= frames) {
+			frame = frames - 1;
+		}
+		if (frame < lastFrame) {
+			frame = lastFrame;
+		}
+		lastFrame = frame;
+
+		VstMidiEvent &event = pool[count++];
+		event.deltaFrames   = frame;
+		memcpy(event.midiData, message.data, sizeof(message.data));
+		read++;
+	}
+
+	tail.store(read, std::memory_order_release);
+
+	if (!count) {
+		return nullptr;
+	}
+
+	delivered += count;
+	block.numEvents = count;
+	return (VstEvents *)&block;
+}
+
+void MidiEventQueue::clear()
+{
+	tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+}
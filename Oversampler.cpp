@@ -0,0 +1,191 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "headers/Oversampler.h"
+#include "headers/vst-simd.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define KAISER_BETA 8.0
+
+/*
+ * The non-zero, non-centre taps of a 63 tap half-band low-pass with its cut
+ * off at a quarter of the high sample rate. Only the even indices of the full
+ * filter survive, so these 32 values are the whole polyphase branch.
+ */
+struct HalfBandCoefficients {
+	float taps[HALFBAND_TAPS];
+
+	HalfBandCoefficients()
+	{
+		const int    length = 2 * HALFBAND_TAPS - 1;
+		const double centre = (length - 1) / 2.0;
+		double       sum    = 0.0;
+
+		for (int i = 0; i < HALFBAND_TAPS; i++) {
+			double offset = 2 * i - centre;
+			double sinc   = sin(M_PI * offset / 2.0) / (M_PI * offset);
+			double window = kaiserWindow(offset / centre, KAISER_BETA);
+
+			taps[i] = (float)(sinc * window);
+			sum += taps[i];
+		}
+
+		// Normalize so the branch has a DC gain of exactly 0.5, like the centre tap
+		for (int i = 0; i < HALFBAND_TAPS; i++) {
+			taps[i] = (float)(taps[i] * 0.5 / sum);
+		}
+	}
+};
+
+static const float *halfBandCoefficients()
+{
+	static const HalfBandCoefficients coefficients;
+	return coefficients.taps;
+}
+
+HalfBandFilter::HalfBandFilter()
+{
+	halfBandCoefficients();
+	reset();
+}
+
+void HalfBandFilter::reset()
+{
+	memset(history, 0, sizeof(history));
+	memset(delay, 0, sizeof(delay));
+	historyPos = 0;
+	delayPos   = 0;
+}
+
+void HalfBandFilter::push(float *buffer, int &pos, float sample)
+{
+	// The buffer is mirrored so buffer[pos..pos + HALFBAND_TAPS) is always a
+	// contiguous window with the newest sample first.
+	pos                         = pos == 0 ? HALFBAND_TAPS - 1 : pos - 1;
+	buffer[pos]                 = sample;
+	buffer[pos + HALFBAND_TAPS] = sample;
+}
+
+void HalfBandFilter::upsample(const float *in, float *out, int frames)
+{
+	const float *coefficients = halfBandCoefficients();
+
+	for (int i = 0; i < frames; i++) {
+		push(history, historyPos, in[i]);
+
+		const float *window = history + historyPos;
+		out[2 * i]          = 2.0f * simdDotProduct(window, coefficients, HALFBAND_TAPS);
+		out[2 * i + 1]      = window[HALFBAND_TAPS / 2 - 1];
+	}
+}
+
+void HalfBandFilter::downsample(const float *in, float *out, int frames)
+{
+	const float *coefficients = halfBandCoefficients();
+
+	for (int i = 0; i < frames; i++) {
+		push(history, historyPos, in[2 * i]);
+		push(delay, delayPos, in[2 * i + 1]);
+
+		const float *window = history + historyPos;
+		out[i] = simdDotProduct(window, coefficients, HALFBAND_TAPS) + 0.5f * delay[delayPos + HALFBAND_TAPS / 2];
+	}
+}
+
+Oversampler::~Oversampler()
+{
+	freeBuffers();
+}
+
+void Oversampler::freeBuffers()
+{
+	for (int stage = 0; stage < OVERSAMPLER_MAX_FACTOR / 2; stage++) {
+		delete[] upStages[stage];
+		delete[] downStages[stage];
+		upStages[stage]   = nullptr;
+		downStages[stage] = nullptr;
+	}
+
+	freePlanes(intermediate, numChannels);
+	freePlanes(highInputs, numChannels);
+	freePlanes(highOutputs, numChannels);
+}
+
+void Oversampler::setFactor(int factor, int numChannels, int blockSize)
+{
+	freeBuffers();
+
+	this->factor      = factor == 4 || factor == 2 ? factor : 1;
+	this->numChannels = numChannels;
+	this->blockSize   = blockSize;
+
+	if (this->factor == 1) {
+		return;
+	}
+
+	for (int stage = 0; stage < numStages(); stage++) {
+		upStages[stage]   = new HalfBandFilter[numChannels];
+		downStages[stage] = new HalfBandFilter[numChannels];
+	}
+
+	intermediate = allocPlanes(numChannels, blockSize * 2);
+	highInputs   = allocPlanes(numChannels, blockSize * this->factor);
+	highOutputs  = allocPlanes(numChannels, blockSize * this->factor);
+}
+
+void Oversampler::reset()
+{
+	for (int stage = 0; stage < numStages(); stage++) {
+		for (int channel = 0; channel < numChannels; channel++) {
+			upStages[stage][channel].reset();
+			downStages[stage][channel].reset();
+		}
+	}
+}
+
+void Oversampler::upsample(int channel, const float *in, int frames)
+{
+	if (factor == 4) {
+		upStages[0][channel].upsample(in, intermediate[channel], frames);
+		upStages[1][channel].upsample(intermediate[channel], highInputs[channel], frames * 2);
+	} else if (factor == 2) {
+		upStages[0][channel].upsample(in, highInputs[channel], frames);
+	}
+}
+
+void Oversampler::downsample(int channel, float *out, int frames)
+{
+	if (factor == 4) {
+		downStages[1][channel].downsample(highOutputs[channel], intermediate[channel], frames * 2);
+		downStages[0][channel].downsample(intermediate[channel], out, frames);
+	} else if (factor == 2) {
+		downStages[0][channel].downsample(highOutputs[channel], out, frames);
+	}
+}
+
+double Oversampler::getLatency() const
+{
+	// Each stage delays by HalfBandFilter::latency() samples of its own
+	// high rate on the way up and again on the way down.
+	double latency = 0.0;
+	for (int stage = 0; stage < numStages(); stage++) {
+		latency += 2.0 * HalfBandFilter::latency() / (2 << stage);
+	}
+	return latency;
+}
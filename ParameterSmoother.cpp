@@ -0,0 +1,166 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "headers/ParameterSmoother.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+ParameterSmoother::~ParameterSmoother()
+{
+	freeBuffers();
+}
+
+void ParameterSmoother::freeBuffers()
+{
+	free(current);
+	free(target);
+	free(increment);
+	free(remaining);
+	free(ramping);
+	free(canRamp);
+	delete[] requested;
+	delete[] dirty;
+
+	current   = nullptr;
+	target    = nullptr;
+	increment = nullptr;
+	remaining = nullptr;
+	ramping   = nullptr;
+	canRamp   = nullptr;
+	requested = nullptr;
+	dirty     = nullptr;
+	numParams = 0;
+}
+
+void ParameterSmoother::configure(AEffect *effect, int rampFrames)
+{
+	freeBuffers();
+
+	this->rampFrames = rampFrames;
+	numParams        = effect ? effect->numParams : 0;
+	numRamping       = 0;
+	pending          = false;
+
+	if (numParams <= 0) {
+		numParams = 0;
+		return;
+	}
+
+	current   = (float *)calloc(numParams, sizeof(float));
+	target    = (float *)calloc(numParams, sizeof(float));
+	increment = (float *)calloc(numParams, sizeof(float));
+	remaining = (int *)calloc(numParams, sizeof(int));
+	ramping   = (int *)calloc(numParams, sizeof(int));
+	canRamp   = (bool *)calloc(numParams, sizeof(bool));
+	requested = new std::atomic<float>[numParams];
+	dirty     = new std::atomic<bool>[numParams];
+
+	for (int i = 0; i < numParams; i++) {
+		requested[i] = 0.0f;
+		dirty[i]     = false;
+
+		/*
+		 * Plug-ins that describe their parameters say which ones may ramp,
+		 * switches never do. Most plug-ins don't implement the opcode at all,
+		 * their parameters are continuous 0..1 values and are ramped.
+		 */
+		VstParameterProperties properties;
+		memset(&properties, 0, sizeof(properties));
+		if (effect->dispatcher(effect, effGetParameterProperties, i, 0, &properties, 0.0f) == 1) {
+			canRamp[i] = (properties.flags & kVstParameterCanRamp) && !(properties.flags & kVstParameterIsSwitch);
+		} else {
+			canRamp[i] = true;
+		}
+	}
+}
+
+void ParameterSmoother::reset()
+{
+	for (int i = 0; i < numRamping; i++) {
+		remaining[ramping[i]] = 0;
+	}
+	numRamping = 0;
+}
+
+void ParameterSmoother::setTarget(int index, float value)
+{
+	if (!isRampable(index)) {
+		return;
+	}
+
+	requested[index].store(value, std::memory_order_relaxed);
+	dirty[index].store(true, std::memory_order_release);
+	pending.store(true, std::memory_order_release);
+}
+
+void ParameterSmoother::update(AEffect *effect)
+{
+	if (!pending.exchange(false, std::memory_order_acquire)) {
+		return;
+	}
+
+	for (int i = 0; i < numParams; i++) {
+		if (!dirty[i].exchange(false, std::memory_order_acquire)) {
+			continue;
+		}
+
+		float value = requested[i].load(std::memory_order_relaxed);
+		if (rampFrames <= 0) {
+			setParameter(effect, i, value);
+			continue;
+		}
+
+		// A ramp that is already running continues from where it is
+		if (!remaining[i]) {
+			current[i]            = effect->getParameter(effect, i);
+			ramping[numRamping++] = i;
+		}
+
+		target[i]    = value;
+		remaining[i] = rampFrames;
+		increment[i] = (value - current[i]) / rampFrames;
+		ramps++;
+	}
+}
+
+void ParameterSmoother::advance(AEffect *effect, int frames)
+{
+	for (int n = 0; n < numRamping;) {
+		int index = ramping[n];
+
+		if (remaining[index] <= frames) {
+			current[index]   = target[index];
+			remaining[index] = 0;
+			ramping[n]       = ramping[--numRamping];
+		} else {
+			current[index] += increment[index] * frames;
+			remaining[index] -= frames;
+			n++;
+		}
+
+		setParameter(effect, index, current[index]);
+	}
+}
+
+void ParameterSmoother::setParameter(AEffect *effect, int index, float value)
+{
+	effect->setParameter(effect, index, value);
+	for (int i = 0; i < numFollowers; i++) {
+		followers[i]->setParameter(followers[i], index, value);
+	}
+}
@@ -0,0 +1,266 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "headers/PluginProfiles.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <QFileInfo>
+#include <QProcess>
+#include <obs-module.h>
+#include <util/platform.h>
+
+struct ProfileEntry {
+	std::string   path;
+	uint32_t      sampleRate = 0;
+	int64_t       modified   = 0;
+	int64_t       size       = 0;
+	bool          failed     = false;
+	PluginProfile profile;
+};
+
+static std::mutex                profilesLock;
+static std::vector<ProfileEntry> profiles;
+static std::thread               profiler;
+static std::atomic<bool>         profilerBusy{false};
+static std::atomic<bool>         stopRequested{false};
+
+static std::string indexPath()
+{
+	char *      path   = obs_module_config_path("plugin-profiles.json");
+	std::string result = path ? path : "";
+	bfree(path);
+	return result;
+}
+
+static void fileStamp(const std::string &path, int64_t &modified, int64_t &size)
+{
+	QFileInfo info(QString::fromStdString(path));
+	modified = info.lastModified().toSecsSinceEpoch();
+	size     = info.size();
+}
+
+// Called with profilesLock held
+static ProfileEntry *findEntry(const std::string &path, uint32_t sampleRate)
+{
+	for (ProfileEntry &entry : profiles) {
+		if (entry.path == path && entry.sampleRate == sampleRate) {
+			return &entry;
+		}
+	}
+	return nullptr;
+}
+
+// An entry is current while the file is the one that was measured
+static bool isCurrent(const ProfileEntry &entry)
+{
+	int64_t modified;
+	int64_t size;
+	fileStamp(entry.path, modified, size);
+	return modified == entry.modified && size == entry.size;
+}
+
+void profilesLoad()
+{
+	obs_data_t *data = obs_data_create_from_json_file(indexPath().c_str());
+	if (!data) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(profilesLock);
+
+	obs_data_array_t *array = obs_data_get_array(data, "profiles");
+	for (size_t index = 0; index < obs_data_array_count(array); index++) {
+		obs_data_t * item = obs_data_array_item(array, index);
+		ProfileEntry entry;
+		entry.path               = obs_data_get_string(item, "path");
+		entry.sampleRate         = (uint32_t)obs_data_get_int(item, "sample_rate");
+		entry.modified           = obs_data_get_int(item, "modified");
+		entry.size               = obs_data_get_int(item, "size");
+		entry.failed             = obs_data_get_bool(item, "failed");
+		entry.profile.usPerBlock = obs_data_get_double(item, "us_per_block");
+		entry.profile.latencyMs  = obs_data_get_double(item, "latency_ms");
+		profiles.push_back(entry);
+		obs_data_release(item);
+	}
+
+	obs_data_array_release(array);
+	obs_data_release(data);
+}
+
+static void saveProfiles()
+{
+	obs_data_t *      data  = obs_data_create();
+	obs_data_array_t *array = obs_data_array_create();
+
+	{
+		std::lock_guard<std::mutex> lock(profilesLock);
+		for (const ProfileEntry &entry : profiles) {
+			obs_data_t *item = obs_data_create();
+			obs_data_set_string(item, "path", entry.path.c_str());
+			obs_data_set_int(item, "sample_rate", entry.sampleRate);
+			obs_data_set_int(item, "modified", entry.modified);
+			obs_data_set_int(item, "size", entry.size);
+			obs_data_set_bool(item, "failed", entry.failed);
+			obs_data_set_double(item, "us_per_block", entry.profile.usPerBlock);
+			obs_data_set_double(item, "latency_ms", entry.profile.latencyMs);
+			obs_data_array_push_back(array, item);
+			obs_data_release(item);
+		}
+	}
+	obs_data_set_array(data, "profiles", array);
+
+	char *directory = obs_module_config_path("");
+	os_mkdirs(directory);
+	bfree(directory);
+
+	obs_data_save_json_safe(data, indexPath().c_str(), "tmp", "bak");
+
+	obs_data_array_release(array);
+	obs_data_release(data);
+}
+
+bool profilerAvailable()
+{
+	const char *profiler = getenv("OBS_VST_PROFILER");
+	return profiler && *profiler;
+}
+
+bool profilingRunning()
+{
+	return profilerBusy;
+}
+
+bool profileLookup(const std::string &path, uint32_t sampleRate, PluginProfile &profile)
+{
+	std::lock_guard<std::mutex> lock(profilesLock);
+
+	ProfileEntry *entry = findEntry(path, sampleRate);
+	if (!entry || entry->failed || !isCurrent(*entry)) {
+		return false;
+	}
+
+	profile = entry->profile;
+	return true;
+}
+
+// Runs the profiler on one plug-in, false if it failed, hung or was stopped
+static bool profileOne(const std::string &path, uint32_t sampleRate, int channels, PluginProfile &profile)
+{
+	QStringList arguments;
+	arguments << "--profile"
+	          << "--rate" << QString::number(sampleRate) << "--channels" << QString::number(channels) << "-p"
+	          << QString::fromStdString(path);
+
+	QProcess process;
+	process.start(QString(getenv("OBS_VST_PROFILER")), arguments);
+	if (!process.waitForStarted()) {
+		return false;
+	}
+
+	uint64_t deadline = os_gettime_ns() + PROFILE_TIMEOUT_MS * 1000000ULL;
+	while (!process.waitForFinished(100)) {
+		if (stopRequested || os_gettime_ns() > deadline || process.state() == QProcess::NotRunning) {
+			process.kill();
+			process.waitForFinished();
+			return false;
+		}
+	}
+
+	if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+		return false;
+	}
+
+	// One line: path, microseconds per block and latency, tab separated
+	std::string output = process.readAllStandardOutput().toStdString();
+	if (output.compare(0, path.size() + 1, path + '\t') != 0) {
+		return false;
+	}
+	return sscanf(output.c_str() + path.size() + 1, "%lf\t%lf", &profile.usPerBlock, &profile.latencyMs) == 2;
+}
+
+void profileAll(const std::vector<std::string> &paths, uint32_t sampleRate, int channels)
+{
+	if (!profilerAvailable() || profilerBusy.exchange(true)) {
+		return;
+	}
+
+	// A finished run may not have been joined yet
+	if (profiler.joinable()) {
+		profiler.join();
+	}
+	stopRequested = false;
+
+	profiler = std::thread([paths, sampleRate, channels]() {
+		int measured = 0;
+		for (const std::string &path : paths) {
+			{
+				std::lock_guard<std::mutex> lock(profilesLock);
+				ProfileEntry *              entry = findEntry(path, sampleRate);
+				if (entry && isCurrent(*entry)) {
+					continue;
+				}
+			}
+
+			ProfileEntry entry;
+			entry.path       = path;
+			entry.sampleRate = sampleRate;
+			fileStamp(path, entry.modified, entry.size);
+			entry.failed = !profileOne(path, sampleRate, channels, entry.profile);
+			if (stopRequested) {
+				break;
+			}
+
+			if (entry.failed) {
+				blog(LOG_WARNING, "VST Plug-in: could not profile '%s'", path.c_str());
+			} else {
+				blog(LOG_INFO,
+				     "VST Plug-in: '%s' takes %.1f us per block, latency %.1f ms",
+				     path.c_str(),
+				     entry.profile.usPerBlock,
+				     entry.profile.latencyMs);
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(profilesLock);
+				ProfileEntry *              previous = findEntry(path, sampleRate);
+				if (previous) {
+					*previous = entry;
+				} else {
+					profiles.push_back(entry);
+				}
+			}
+			saveProfiles();
+			measured++;
+		}
+
+		blog(LOG_INFO, "VST Plug-in: profiled %d plug-ins", measured);
+		profilerBusy = false;
+	});
+}
+
+void profilesStop()
+{
+	stopRequested = true;
+	if (profiler.joinable()) {
+		profiler.join();
+	}
+}
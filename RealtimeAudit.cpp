@@ -0,0 +1,42 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "headers/RealtimeAudit.h"
+
+#include <obs-module.h>
+#include <dlfcn.h>
+
+typedef const char *(*swapOwnerFunc)(const char *owner);
+
+// Resolved once at module load, the audio thread only reads it
+static swapOwnerFunc swapOwner = nullptr;
+
+void realtimeAuditInit()
+{
+	swapOwner = (swapOwnerFunc)dlsym(RTLD_DEFAULT, "obs_vst_audit_swap_owner");
+
+	if (swapOwner) {
+		blog(LOG_INFO, "VST Plug-in: real-time audit active, violations are reported on stderr");
+	} else {
+		blog(LOG_WARNING, "VST Plug-in: built with VST_RT_AUDIT but libobs-vst-rt-audit is not preloaded");
+	}
+}
+
+const char *realtimeAuditSwapOwner(const char *owner)
+{
+	return swapOwner ? swapOwner(owner) : nullptr;
+}
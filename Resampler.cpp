@@ -0,0 +1,255 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "headers/Resampler.h"
+#include "headers/vst-simd.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define KAISER_BETA 9.0
+#define PASSBAND_ROLLOFF 0.9
+
+static uint32_t greatestCommonDivisor(uint32_t a, uint32_t b)
+{
+	while (b) {
+		uint32_t t = a % b;
+		a          = b;
+		b          = t;
+	}
+	return a;
+}
+
+Resampler::~Resampler()
+{
+	freeBuffers();
+}
+
+void Resampler::freeBuffers()
+{
+	free(bank);
+	bank = nullptr;
+
+	freePlanes(history, numChannels);
+}
+
+void Resampler::configure(uint32_t inRate, uint32_t outRate, int numChannels)
+{
+	freeBuffers();
+
+	uint32_t divisor  = greatestCommonDivisor(inRate, outRate);
+	upFactor          = outRate / divisor;
+	downFactor        = inRate / divisor;
+	this->numChannels = numChannels;
+
+	// Cut off below the lower of both Nyquist frequencies, in input cycles
+	double ratio  = (double)outRate / inRate;
+	double cutoff = 0.5 * PASSBAND_ROLLOFF * (ratio < 1.0 ? ratio : 1.0);
+
+	/*
+	 * Row p of the bank holds the kernel for an output that lies p / upFactor
+	 * of an input sample after the centre of the history window. The window
+	 * is stored newest sample first, so tap j sits j samples in the past.
+	 */
+	bank = (float *)malloc(sizeof(float) * upFactor * RESAMPLER_TAPS);
+	for (uint32_t p = 0; p < upFactor; p++) {
+		float *row = bank + p * RESAMPLER_TAPS;
+		double sum = 0.0;
+
+		for (int j = 0; j < RESAMPLER_TAPS; j++) {
+			double t      = j - RESAMPLER_TAPS / 2 + (double)p / upFactor;
+			double x      = 2.0 * cutoff * t;
+			double sinc   = x == 0.0 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+			double window = kaiserWindow(t / (RESAMPLER_TAPS / 2), KAISER_BETA);
+
+			row[j] = (float)(sinc * window);
+			sum += row[j];
+		}
+
+		// Unity gain at DC for every phase
+		for (int j = 0; j < RESAMPLER_TAPS; j++) {
+			row[j] = (float)(row[j] / sum);
+		}
+	}
+
+	history = allocPlanes(numChannels, 2 * RESAMPLER_TAPS);
+	reset();
+}
+
+void Resampler::reset()
+{
+	phase      = 0;
+	historyPos = 0;
+
+	for (int channel = 0; channel < numChannels; channel++) {
+		memset(history[channel], 0, 2 * RESAMPLER_TAPS * sizeof(float));
+	}
+}
+
+int Resampler::maxOutputFrames(int frames) const
+{
+	return (int)(((uint64_t)frames * upFactor + downFactor - 1) / downFactor) + 1;
+}
+
+int Resampler::process(float *const *in, float **out, int frames)
+{
+	uint32_t endPhase = phase;
+	int      endPos   = historyPos;
+	int      produced = 0;
+
+	for (int channel = 0; channel < numChannels; channel++) {
+		if (!in[channel]) {
+			continue;
+		}
+
+		const float *input  = in[channel];
+		float *      output = out[channel];
+		float *      buffer = history[channel];
+		uint32_t     p      = phase;
+		int          pos    = historyPos;
+		int          n      = 0;
+
+		for (int i = 0; i < frames; i++) {
+			// Mirrored history, buffer[pos..pos + RESAMPLER_TAPS) is contiguous
+			pos                          = pos == 0 ? RESAMPLER_TAPS - 1 : pos - 1;
+			buffer[pos]                  = input[i];
+			buffer[pos + RESAMPLER_TAPS] = input[i];
+
+			for (; p < upFactor; p += downFactor) {
+				output[n++] = simdDotProduct(buffer + pos, bank + p * RESAMPLER_TAPS, RESAMPLER_TAPS);
+			}
+			p -= upFactor;
+		}
+
+		endPhase = p;
+		endPos   = pos;
+		produced = n;
+	}
+
+	if (!produced) {
+		// No active channel, only advance the shared state
+		for (int i = 0; i < frames; i++) {
+			endPos = endPos == 0 ? RESAMPLER_TAPS - 1 : endPos - 1;
+			for (; endPhase < upFactor; endPhase += downFactor) {
+				produced++;
+			}
+			endPhase -= upFactor;
+		}
+	}
+
+	phase      = endPhase;
+	historyPos = endPos;
+	return produced;
+}
+
+RateConverter::~RateConverter()
+{
+	freeBuffers();
+}
+
+void RateConverter::freeBuffers()
+{
+	freePlanes(internalInputs, numChannels);
+	freePlanes(internalOutputs, numChannels);
+	freePlanes(converted, numChannels);
+	free(channelActive);
+	channelActive = nullptr;
+}
+
+void RateConverter::configure(uint32_t hostRate, uint32_t internalRate, int numChannels, int maxHostFrames)
+{
+	freeBuffers();
+
+	this->hostRate     = hostRate;
+	this->internalRate = internalRate == hostRate ? 0 : internalRate;
+	this->numChannels  = numChannels < RATE_CONVERTER_MAX_CHANNELS ? numChannels : RATE_CONVERTER_MAX_CHANNELS;
+
+	if (!this->internalRate) {
+		maxInternalFrames = maxHostFrames;
+		return;
+	}
+
+	toInternal.configure(hostRate, internalRate, this->numChannels);
+	toHost.configure(internalRate, hostRate, this->numChannels);
+
+	maxInternalFrames = toInternal.maxOutputFrames(maxHostFrames);
+	int maxConverted  = toHost.maxOutputFrames(maxInternalFrames);
+
+	internalInputs  = allocPlanes(this->numChannels, maxInternalFrames);
+	internalOutputs = allocPlanes(this->numChannels, maxInternalFrames);
+	converted       = allocPlanes(this->numChannels, maxConverted);
+	channelActive   = (bool *)calloc(this->numChannels, sizeof(bool));
+
+	outputFifo.setCapacity(this->numChannels, maxHostFrames + maxConverted + RATE_CONVERTER_PRIME_FRAMES);
+	reset();
+}
+
+void RateConverter::reset()
+{
+	if (!internalRate) {
+		return;
+	}
+
+	toInternal.reset();
+	toHost.reset();
+	outputFifo.clear();
+	outputFifo.writeSilence(RATE_CONVERTER_PRIME_FRAMES);
+}
+
+int RateConverter::convertInput(float *const *in, int frames)
+{
+	for (int channel = 0; channel < numChannels; channel++) {
+		channelActive[channel] = in[channel] != nullptr;
+	}
+
+	return toInternal.process(in, internalInputs, frames);
+}
+
+void RateConverter::convertOutput(float **out, int internalFrames, int frames)
+{
+	float *source[RATE_CONVERTER_MAX_CHANNELS];
+	float *target[RATE_CONVERTER_MAX_CHANNELS];
+
+	for (int channel = 0; channel < numChannels; channel++) {
+		source[channel] = channelActive[channel] ? internalOutputs[channel] : nullptr;
+		target[channel] = channelActive[channel] ? out[channel] : nullptr;
+	}
+
+	int convertedFrames = toHost.process(source, converted, internalFrames);
+	outputFifo.write(converted, convertedFrames);
+
+	int read = outputFifo.read(target, frames);
+	if (read < frames) {
+		// Ran dry, pad with silence and prime again so it stays ahead
+		for (int channel = 0; channel < numChannels; channel++) {
+			if (target[channel]) {
+				memset(target[channel] + read, 0, (frames - read) * sizeof(float));
+			}
+		}
+		outputFifo.writeSilence(RATE_CONVERTER_PRIME_FRAMES);
+	}
+}
+
+double RateConverter::getLatency() const
+{
+	if (!internalRate) {
+		return 0.0;
+	}
+
+	return Resampler::getLatency() + Resampler::getLatency() * hostRate / internalRate +
+	       RATE_CONVERTER_PRIME_FRAMES;
+}
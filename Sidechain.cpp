@@ -0,0 +1,257 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "headers/Sidechain.h"
+#include "headers/vst-simd.hpp"
+
+#include <string.h>
+#include <util/platform.h>
+
+SidechainRing::~SidechainRing()
+{
+	freeBuffers();
+}
+
+void SidechainRing::freeBuffers()
+{
+	freePlanes(planes, numChannels);
+	freePlanes(scratch, numChannels);
+	free(silence);
+	silence = nullptr;
+}
+
+void SidechainRing::configure(int numChannels, uint32_t sampleRate, int maxFrames)
+{
+	freeBuffers();
+
+	this->numChannels = numChannels;
+	this->sampleRate  = sampleRate;
+	this->maxFrames   = maxFrames;
+
+	planes  = allocPlanes(numChannels, SIDECHAIN_RING_FRAMES);
+	scratch = allocPlanes(numChannels, maxFrames);
+	silence = (float *)calloc(maxFrames, sizeof(float));
+
+	writePos       = 0;
+	readPos        = 0;
+	lastAnchorPos  = 0;
+	lastAnchorTime = 0;
+	resync         = true;
+}
+
+void SidechainRing::write(uint8_t *const *data, int frames, uint64_t timestamp, bool muted)
+{
+	uint64_t position = writePos.load(std::memory_order_relaxed);
+
+	// Only the newest frames fit when a packet is larger than the whole ring
+	int skip = frames > SIDECHAIN_RING_FRAMES ? frames - SIDECHAIN_RING_FRAMES : 0;
+
+	// The producer is the only one moving the anchor, it reads it as is
+	uint64_t pos      = anchorPos.load(std::memory_order_relaxed);
+	uint64_t time     = anchorTime.load(std::memory_order_relaxed);
+	double   expected = (double)time + (double)(position - pos) * 1000000000.0 / sampleRate;
+	double   drift    = (double)timestamp - expected;
+
+	if (resync.exchange(false) || fabs(drift) > SIDECHAIN_RESYNC_MS * 1000000.0) {
+		uint32_t seq = anchorSeq.load(std::memory_order_relaxed);
+		anchorSeq.store(seq + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		anchorPos.store(position, std::memory_order_relaxed);
+		anchorTime.store(timestamp, std::memory_order_relaxed);
+		anchorSeq.store(seq + 2, std::memory_order_release);
+	}
+
+	position += skip;
+	frames -= skip;
+
+	uint32_t index = (uint32_t)(position & (SIDECHAIN_RING_FRAMES - 1));
+	int      first = frames < SIDECHAIN_RING_FRAMES - (int)index ? frames : SIDECHAIN_RING_FRAMES - (int)index;
+
+	for (int channel = 0; channel < numChannels; channel++) {
+		float *target = planes[channel];
+		if (muted || !data[channel]) {
+			memset(target + index, 0, first * sizeof(float));
+			memset(target, 0, (frames - first) * sizeof(float));
+			continue;
+		}
+
+		const float *source = (const float *)data[channel] + skip;
+		memcpy(target + index, source, first * sizeof(float));
+		memcpy(target, source + first, (frames - first) * sizeof(float));
+	}
+
+	writePos.store(position + frames, std::memory_order_release);
+}
+
+void SidechainRing::read(float **out, int frames, uint64_t timestamp)
+{
+	uint64_t written = writePos.load(std::memory_order_acquire);
+	if (written < (uint64_t)frames) {
+		for (int channel = 0; channel < numChannels; channel++) {
+			out[channel] = silence;
+		}
+		silentReads++;
+		return;
+	}
+
+	// Racing an anchor update is rare, the previous anchor does for that pass
+	uint32_t seq  = anchorSeq.load(std::memory_order_acquire);
+	uint64_t pos  = anchorPos.load(std::memory_order_relaxed);
+	uint64_t time = anchorTime.load(std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (!(seq & 1) && seq == anchorSeq.load(std::memory_order_relaxed)) {
+		lastAnchorPos  = pos;
+		lastAnchorTime = time;
+	}
+
+	double  seconds   = (double)(int64_t)(timestamp - lastAnchorTime) / 1000000000.0;
+	int64_t target    = (int64_t)lastAnchorPos + (int64_t)llround(seconds * sampleRate);
+	int64_t newest    = (int64_t)(written - frames);
+	int64_t oldest    = (int64_t)written - SIDECHAIN_RING_FRAMES / 2;
+	int64_t tolerance = (int64_t)sampleRate * SIDECHAIN_RESYNC_MS / 1000;
+
+	int64_t start = (int64_t)readPos;
+	if (llabs(target - start) > tolerance) {
+		start = target;
+		jumps++;
+	}
+	if (start > newest) {
+		start = newest;
+		lateReads++;
+	}
+	if (start < oldest) {
+		start = oldest;
+	}
+	readPos = (uint64_t)start + frames;
+
+	uint32_t index = (uint32_t)((uint64_t)start & (SIDECHAIN_RING_FRAMES - 1));
+	int      first = SIDECHAIN_RING_FRAMES - (int)index;
+
+	for (int channel = 0; channel < numChannels; channel++) {
+		if (frames <= first) {
+			out[channel] = planes[channel] + index;
+			continue;
+		}
+
+		memcpy(scratch[channel], planes[channel] + index, first * sizeof(float));
+		memcpy(scratch[channel] + first, planes[channel], (frames - first) * sizeof(float));
+		out[channel] = scratch[channel];
+	}
+}
+
+Sidechain::~Sidechain()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	detach();
+}
+
+void Sidechain::capture_static(void *param, obs_source_t *source, const struct audio_data *audio, bool muted)
+{
+	UNUSED_PARAMETER(source);
+
+	Sidechain *sidechain = static_cast<Sidechain *>(param);
+	sidechain->ring.write(audio->data, (int)audio->frames, audio->timestamp, muted);
+}
+
+// Called with lock held
+void Sidechain::attach(obs_source_t *source)
+{
+	ring.restart();
+	weakSource = obs_source_get_weak_source(source);
+	obs_source_add_audio_capture_callback(source, capture_static, this);
+	connected = true;
+
+	blog(LOG_INFO, "VST Plug-in: sidechain connected to '%s'", sourceName.c_str());
+}
+
+// Called with lock held
+void Sidechain::detach()
+{
+	if (!weakSource) {
+		return;
+	}
+
+	// Once this returns no capture callback is running any more
+	obs_source_t *source = obs_weak_source_get_source(weakSource);
+	if (source) {
+		obs_source_remove_audio_capture_callback(source, capture_static, this);
+		obs_source_release(source);
+	}
+
+	obs_weak_source_release(weakSource);
+	weakSource = nullptr;
+	connected  = false;
+}
+
+void Sidechain::setSource(const char *name, int numChannels, uint32_t sampleRate, int maxFrames)
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	if (sourceName == name) {
+		return;
+	}
+
+	detach();
+	sourceName = name;
+	lastLookup = 0;
+
+	if (!sourceName.empty() && !ring.isConfigured()) {
+		ring.configure(numChannels, sampleRate, maxFrames);
+	}
+}
+
+void Sidechain::update()
+{
+	std::lock_guard<std::mutex> guard(lock);
+
+	if (sourceName.empty()) {
+		return;
+	}
+
+	if (weakSource) {
+		obs_source_t *source = obs_weak_source_get_source(weakSource);
+		if (source) {
+			obs_source_release(source);
+			return;
+		}
+
+		// Removed, its capture callbacks went away with it
+		obs_weak_source_release(weakSource);
+		weakSource = nullptr;
+		connected  = false;
+		blog(LOG_INFO, "VST Plug-in: sidechain source '%s' went away", sourceName.c_str());
+	}
+
+	uint64_t now = os_gettime_ns();
+	if (lastLookup && now - lastLookup < SIDECHAIN_LOOKUP_INTERVAL_NS) {
+		return;
+	}
+	lastLookup = now;
+
+	obs_source_t *source = obs_get_source_by_name(sourceName.c_str());
+	if (source) {
+		attach(source);
+		obs_source_release(source);
+	}
+}
+
+std::string Sidechain::getSourceName()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return sourceName;
+}
@@ -0,0 +1,194 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "headers/Tracer.h"
+
+#include <obs-module.h>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct TraceEventRecord {
+	uint64_t    start;
+	uint64_t    end;
+	const char *name;
+	uint32_t    thread;
+	char        detail[TRACE_DETAIL_LENGTH];
+};
+
+struct TraceBuffer {
+	TraceEventRecord      events[TRACE_EVENTS_PER_THREAD];
+	std::atomic<uint64_t> written{0};
+	std::atomic<bool>     claimed{false};
+};
+
+std::atomic<bool> traceEnabled{false};
+
+static TraceBuffer *         buffers    = nullptr;
+static std::atomic<uint32_t> nextThread{1};
+static std::atomic<uint64_t> dropped{0};
+static uint64_t              traceStart = 0;
+static char *                tracePath  = nullptr;
+
+// Owns the buffer of one thread and hands it back when the thread exits
+struct TraceSlot {
+	TraceBuffer *buffer = nullptr;
+	uint32_t     thread = 0;
+
+	bool claim()
+	{
+		for (int i = 0; i < TRACE_MAX_THREADS; i++) {
+			bool expected = false;
+			if (buffers[i].claimed.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+				buffer = &buffers[i];
+				thread = nextThread.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	~TraceSlot()
+	{
+		if (buffer) {
+			buffer->claimed.store(false, std::memory_order_release);
+		}
+	}
+};
+
+static thread_local TraceSlot threadSlot;
+
+void traceInit()
+{
+	const char *path = getenv("OBS_VST_TRACE");
+	if (!path || !*path) {
+		return;
+	}
+
+	buffers = new (std::nothrow) TraceBuffer[TRACE_MAX_THREADS];
+	if (!buffers) {
+		blog(LOG_WARNING, "VST Plug-in: not enough memory for tracing");
+		return;
+	}
+
+	tracePath  = strdup(path);
+	traceStart = os_gettime_ns();
+	traceEnabled.store(true);
+
+	blog(LOG_INFO, "VST Plug-in: tracing to '%s'", tracePath);
+}
+
+void traceEvent(const char *name, const char *detail, uint64_t start, uint64_t end)
+{
+	// Threads without a buffer try again on every span, one may have exited
+	if (!threadSlot.buffer && !threadSlot.claim()) {
+		dropped++;
+		return;
+	}
+
+	TraceBuffer &buffer  = *threadSlot.buffer;
+	uint64_t     written = buffer.written.load(std::memory_order_relaxed);
+
+	TraceEventRecord &event = buffer.events[written % TRACE_EVENTS_PER_THREAD];
+	event.start             = start;
+	event.end               = end;
+	event.name              = name;
+	event.thread            = threadSlot.thread;
+	event.detail[0]         = 0;
+	if (detail) {
+		strncpy(event.detail, detail, TRACE_DETAIL_LENGTH - 1);
+		event.detail[TRACE_DETAIL_LENGTH - 1] = 0;
+	}
+
+	buffer.written.store(written + 1, std::memory_order_release);
+}
+
+static void writeJsonString(FILE *file, const char *text)
+{
+	fputc('"', file);
+	for (const char *c = text; *c; c++) {
+		if (*c == '"' || *c == '\\') {
+			fprintf(file, "\\%c", *c);
+		} else if ((unsigned char)*c >= 0x20) {
+			fputc(*c, file);
+		}
+	}
+	fputc('"', file);
+}
+
+void traceWrite()
+{
+	if (!traceEnabled.exchange(false)) {
+		return;
+	}
+
+	FILE *file = os_fopen(tracePath, "w");
+	if (!file) {
+		blog(LOG_WARNING, "VST Plug-in: could not write trace to '%s'", tracePath);
+		return;
+	}
+
+	fprintf(file, "{\"traceEvents\": [");
+
+	bool     separator   = false;
+	uint64_t overwritten = 0;
+
+	for (int i = 0; i < TRACE_MAX_THREADS; i++) {
+		TraceBuffer &buffer  = buffers[i];
+		uint64_t     written = buffer.written.load(std::memory_order_acquire);
+		uint64_t     first   = written > TRACE_EVENTS_PER_THREAD ? written - TRACE_EVENTS_PER_THREAD : 0;
+		overwritten += first;
+
+		for (uint64_t n = first; n < written; n++) {
+			TraceEventRecord event = buffer.events[n % TRACE_EVENTS_PER_THREAD];
+
+			// A thread still running may have wrapped around onto this span while it was copied
+			if (buffer.written.load(std::memory_order_acquire) - n >= TRACE_EVENTS_PER_THREAD) {
+				continue;
+			}
+
+			fprintf(file,
+			        "%s\n{\"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"name\": \"%s\", \"ts\": %.3f, \"dur\": %.3f",
+			        separator ? "," : "",
+			        event.thread,
+			        event.name,
+			        (event.start - traceStart) / 1000.0,
+			        (event.end - event.start) / 1000.0);
+			if (event.detail[0]) {
+				fprintf(file, ", \"args\": {\"detail\": ");
+				writeJsonString(file, event.detail);
+				fputc('}', file);
+			}
+			fputc('}', file);
+			separator = true;
+		}
+	}
+
+	fprintf(file, "\n], \"displayTimeUnit\": \"ms\"}\n");
+	fclose(file);
+
+	blog(LOG_INFO,
+	     "VST Plug-in: trace written to '%s', %llu older spans overwritten, %llu spans dropped",
+	     tracePath,
+	     (unsigned long long)overwritten,
+	     (unsigned long long)dropped.load());
+
+	// Late spans from threads still running are simply not recorded
+	free(tracePath);
+	tracePath = nullptr;
+}
@@ -0,0 +1,39 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "headers/VSTHost.h"
+
+class ObsHost : public VSTHost {
+public:
+	uint32_t getSampleRate() override { return audio_output_get_sample_rate(obs_get_audio()); }
+	int      getChannels() override { return (int)audio_output_get_channels(obs_get_audio()); }
+
+	const char *getFilterName(obs_source_t *filter) override { return filter ? obs_source_get_name(filter) : nullptr; }
+
+	const char *getTargetName(obs_source_t *filter) override
+	{
+		obs_source_t *target = filter ? obs_filter_get_target(filter) : nullptr;
+		return target ? obs_source_get_name(target) : nullptr;
+	}
+};
+
+VSTHost *getObsHost()
+{
+	static ObsHost host;
+	return &host;
+}
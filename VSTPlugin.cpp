@@ -17,25 +17,98 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *****************************************************************************/
 
 #include "headers/VSTPlugin.h"
+#include "headers/Base64.h"
+#include "headers/vst-simd.hpp"
+#ifdef __linux__
+#include "headers/EditorThread.h"
+#endif
 
-VSTPlugin::VSTPlugin(obs_source_t *sourceContext) : sourceContext{sourceContext}
+#include <util/platform.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HOST_TEMPO 120.0
+#define HOST_VENDOR_STRING "OBS Project"
+#define HOST_PRODUCT_STRING "OBS Studio"
+#define HOST_VENDOR_VERSION 1
+
+// Consecutive passes with invalid output before the plug-in is reset
+#define SANITIZER_RESET_PASSES 4
+
+// Set while the audio thread is inside process(), for audioMasterGetCurrentProcessLevel
+static thread_local bool inAudioProcess = false;
+
+/*
+ * Speaker arrangements offered to the plug-in, by channel count and in OBS
+ * channel order. OBS has no 3.0 or 7.0 layout, 3 channels are its 2.1.
+ */
+static const struct {
+	int32_t type;
+	int32_t speakers[VST_MAX_CHANNELS];
+} speakerLayouts[VST_MAX_CHANNELS + 1] = {
+        {kSpeakerArrEmpty, {}},
+        {kSpeakerArrMono, {kSpeakerM}},
+        {kSpeakerArrStereo, {kSpeakerL, kSpeakerR}},
+        {kSpeakerArrUserDefined, {kSpeakerL, kSpeakerR, kSpeakerLfe}},
+        {kSpeakerArr40Cine, {kSpeakerL, kSpeakerR, kSpeakerC, kSpeakerS}},
+        {kSpeakerArr41Cine, {kSpeakerL, kSpeakerR, kSpeakerC, kSpeakerLfe, kSpeakerS}},
+        {kSpeakerArr51, {kSpeakerL, kSpeakerR, kSpeakerC, kSpeakerLfe, kSpeakerLs, kSpeakerRs}},
+        {kSpeakerArrUserDefined,
+         {kSpeakerL, kSpeakerR, kSpeakerC, kSpeakerLfe, kSpeakerLs, kSpeakerRs, kSpeakerUndefined}},
+        {kSpeakerArr71Music,
+         {kSpeakerL, kSpeakerR, kSpeakerC, kSpeakerLfe, kSpeakerLs, kSpeakerRs, kSpeakerSl, kSpeakerSr}},
+};
+
+// Channels past the speaker layout, such as a sidechain, stay undefined
+static void fillArrangement(VstSpeakerArrangement &arrangement, int channels, int layoutChannels)
+{
+	channels       = channels < VST_MAX_CHANNELS ? channels : VST_MAX_CHANNELS;
+	layoutChannels = layoutChannels < channels ? layoutChannels : channels;
+
+	memset(&arrangement, 0, sizeof(arrangement));
+	arrangement.type        = channels == layoutChannels ? speakerLayouts[channels].type : kSpeakerArrUserDefined;
+	arrangement.numChannels = channels;
+	for (int channel = 0; channel < channels; channel++) {
+		arrangement.speakers[channel].type =
+		        channel < layoutChannels ? speakerLayouts[layoutChannels].speakers[channel] : kSpeakerUndefined;
+	}
+}
+
+VSTPlugin::VSTPlugin(obs_source_t *sourceContext, VSTHost *host) : sourceContext{sourceContext}, host{host}
 {
 
 	int numChannels = VST_MAX_CHANNELS;
 	int blocksize   = BLOCK_SIZE;
 
+	sampleRate = host->getSampleRate();
+	rateConverter.configure(sampleRate, 0, numChannels, blocksize);
+
 	inputs  = (float **)malloc(sizeof(float *) * numChannels);
 	outputs = (float **)malloc(sizeof(float *) * numChannels);
 	for (int channel = 0; channel < numChannels; channel++) {
-		inputs[channel]  = (float *)malloc(sizeof(float) * blocksize);
+		inputs[channel]  = (float *)calloc(blocksize, sizeof(float));
 		outputs[channel] = (float *)malloc(sizeof(float) * blocksize);
 	}
+
+	jobInputs   = allocPlanes(numChannels, blocksize);
+	routedMixes = allocPlanes(numChannels, blocksize);
+	meter.configure(sampleRate, getOutputChannels());
+
+	configureRouting();
+	limitRouting();
+	fillArrangement(inputArrangement, routing.getInputs(), routing.getInputs());
+	fillArrangement(outputArrangement, routing.getOutputs(), routing.getOutputs());
 }
 
 VSTPlugin::~VSTPlugin()
 {
 	int numChannels = VST_MAX_CHANNELS;
 
+	// Let an overrunning pass finish before its buffers go away
+	worker.stop();
+
 	for (int channel = 0; channel < numChannels; channel++) {
 		if (inputs[channel]) {
 			free(inputs[channel]);
@@ -54,12 +127,18 @@ VSTPlugin::~VSTPlugin()
 		free(outputs);
 		outputs = NULL;
 	}
+	freePlanes(jobInputs, numChannels);
+	freePlanes(routedMixes, numChannels);
+	freeDoublePlanes(doubleInputs, numChannels);
+	freeDoublePlanes(doubleOutputs, numChannels);
 
 	unloadEffect();
 }
 
 void VSTPlugin::loadEffectFromPath(std::string path)
 {
+	TraceScope trace("loadEffectFromPath", path.c_str());
+
 	if (this->pluginPath.compare(path) != 0) {
 		closeEditor();
 		unloadEffect();
@@ -89,9 +168,10 @@ void VSTPlugin::loadEffectFromPath(std::string path)
 		// It is better to invoke this code after checking magic number
 		effect->dispatcher(effect, effGetEffectName, 0, 0, effectName, 0);
 		effect->dispatcher(effect, effGetVendorString, 0, 0, vendorString, 0);
+		recorder.setLabel(effectName);
 
-		// This check logic is refer to open source project : Audacity
-		if ((effect->flags & effFlagsIsSynth) || !(effect->flags & effFlagsCanReplacing)) {
+		// Synths are fine as long as they replace, they are driven through MIDI
+		if (!(effect->flags & effFlagsCanReplacing)) {
 			blog(LOG_WARNING, "VST Plug-in can't support replacing. '%s'", path.c_str());
 			return;
 		}
@@ -101,13 +181,30 @@ void VSTPlugin::loadEffectFromPath(std::string path)
 
 		effect->dispatcher(effect, effOpen, 0, 0, nullptr, 0.0f);
 
+		smoother.configure(effect, smoothingTime * (int)sampleRate / 1000);
+
+		acceptsMidi = (effect->flags & effFlagsIsSynth) ||
+		              effect->dispatcher(effect, effCanDo, 0, 0, (void *)"receiveVstMidiEvent", 0.0f) > 0 ||
+		              effect->dispatcher(effect, effCanDo, 0, 0, (void *)"receiveVstEvents", 0.0f) > 0;
+
+		// Negotiated before anything else, the plug-in may only change its
+		// channel count while suspended
+		configureRouting();
+		if (!negotiateArrangement()) {
+			return;
+		}
+
 		// Set some default properties
-		size_t sampleRate = audio_output_get_sample_rate(obs_get_audio());
-		effect->dispatcher(effect, effSetSampleRate, 0, 0, nullptr, sampleRate);
-		int blocksize = BLOCK_SIZE;
-		effect->dispatcher(effect, effSetBlockSize, 0, blocksize, nullptr, 0.0f);
+		updateProcessingFormat();
+
+		if (stereoPairs) {
+			createPairs();
+		}
+		limitRouting();
 
-		effect->dispatcher(effect, effMainsChanged, 0, 1, nullptr, 0);
+		if (filterEnabled && targetActive) {
+			resumeEffect();
+		}
 
 		effectReady = true;
 
@@ -126,196 +223,1748 @@ void silenceChannel(float **channelData, int numChannels, long numFrames)
 	}
 }
 
-obs_audio_data *VSTPlugin::process(struct obs_audio_data *audio)
+uint32_t VSTPlugin::getProcessingRate()
 {
-	if (effect && effectReady) {
-		uint passes = (audio->frames + BLOCK_SIZE - 1) / BLOCK_SIZE;
-		uint extra  = audio->frames % BLOCK_SIZE;
-		for (uint pass = 0; pass < passes; pass++) {
-			uint frames = pass == passes - 1 && extra ? extra : BLOCK_SIZE;
-			silenceChannel(outputs, VST_MAX_CHANNELS, BLOCK_SIZE);
+	return rateConverter.isActive() ? rateConverter.getInternalRate() : sampleRate;
+}
 
-			float *adata[VST_MAX_CHANNELS];
-			for (size_t d = 0; d < VST_MAX_CHANNELS; d++) {
-				if (audio->data[d] != nullptr) {
-					adata[d] = ((float *)audio->data[d]) + (pass * BLOCK_SIZE);
-				} else {
-					adata[d] = inputs[d];
-				}
-			};
+float VSTPlugin::getEffectSampleRate()
+{
+	return (float)getProcessingRate() * oversampler.getFactor();
+}
 
-			effect->processReplacing(effect, adata, outputs, frames);
+int VSTPlugin::getEffectBlockSize()
+{
+	if (accumulator.isActive()) {
+		return accumulator.getBlockSize();
+	}
+	return rateConverter.getMaxInternalFrames() * oversampler.getFactor();
+}
 
-			for (size_t c = 0; c < VST_MAX_CHANNELS; c++) {
-				if (audio->data[c]) {
-					for (size_t i = 0; i < frames; i++) {
-						adata[c][i] = outputs[c][i];
-					}
-				}
-			}
+// Channels actually handed to the plug-in, pairs take two each
+void VSTPlugin::getEffectChannels(int &inputChannels, int &outputChannels)
+{
+	inputChannels  = numPairs ? 2 * (numPairs + 1) : effect->numInputs;
+	outputChannels = numPairs ? 2 * (numPairs + 1) : effect->numOutputs;
+	inputChannels  = inputChannels < VST_MAX_CHANNELS ? inputChannels : VST_MAX_CHANNELS;
+	outputChannels = outputChannels < VST_MAX_CHANNELS ? outputChannels : VST_MAX_CHANNELS;
+}
+
+void VSTPlugin::updateProcessingFormat()
+{
+	// Only plug-ins built against VST 2.4 may process doubles
+	bool canDouble = (effect->flags & effFlagsCanDoubleReplacing) && effect->processDoubleReplacing;
+	if (doublePrecision && !canDouble) {
+		blog(LOG_INFO, "VST Plug-in: '%s' can't process 64-bit samples, using 32-bit", effectName);
+	}
+	processDouble = doublePrecision && canDouble;
+
+	accumulator.configure(
+	        accumulationFrames, VST_MAX_CHANNELS, rateConverter.getMaxInternalFrames() * oversampler.getFactor());
+
+	freeDoublePlanes(doubleInputs, VST_MAX_CHANNELS);
+	freeDoublePlanes(doubleOutputs, VST_MAX_CHANNELS);
+	if (processDouble) {
+		doubleInputs  = allocDoublePlanes(VST_MAX_CHANNELS, getEffectBlockSize());
+		doubleOutputs = allocDoublePlanes(VST_MAX_CHANNELS, getEffectBlockSize());
+	}
+
+	setEffectFormat(effect);
+	for (int pair = 0; pair < numPairs; pair++) {
+		setEffectFormat(pairEffects[pair]);
+	}
+}
+
+void VSTPlugin::setEffectFormat(AEffect *target)
+{
+	target->dispatcher(target, effSetSampleRate, 0, 0, nullptr, getEffectSampleRate());
+	target->dispatcher(target, effSetBlockSize, 0, getEffectBlockSize(), nullptr, 0.0f);
+
+	if (target->flags & effFlagsCanDoubleReplacing) {
+		int precision = processDouble ? kVstProcessPrecision64 : kVstProcessPrecision32;
+		target->dispatcher(target, effSetProcessPrecision, 0, precision, nullptr, 0.0f);
+	}
+}
+
+void VSTPlugin::setProcessingOptions(int oversampling, uint32_t internalRate)
+{
+	std::lock_guard<std::mutex> lock(processLock);
+	worker.waitIdle();
+
+	if (oversampling != 2 && oversampling != 4) {
+		oversampling = 1;
+	}
+	if (internalRate == sampleRate) {
+		internalRate = 0;
+	}
+
+	if (oversampling == oversampler.getFactor() && internalRate == rateConverter.getInternalRate()) {
+		return;
+	}
+
+	rateConverter.configure(sampleRate, internalRate, VST_MAX_CHANNELS, BLOCK_SIZE);
+	oversampler.setFactor(oversampling, VST_MAX_CHANNELS, rateConverter.getMaxInternalFrames());
+	resamplerTime   = 0;
+	resamplerBlocks = 0;
+	converterTime   = 0;
+	converterBlocks = 0;
+
+	if (effect && effectReady) {
+		// Sample rate and block size may only change while suspended
+		bool wasRunning = running;
+		if (wasRunning) {
+			suspendEffect();
+		}
+		updateProcessingFormat();
+		if (wasRunning) {
+			resumeEffect();
 		}
 	}
 
-	return audio;
+	blog(LOG_INFO,
+	     "VST Plug-in: processing at %u Hz with %dx oversampling, latency %.1f frames",
+	     getProcessingRate(),
+	     oversampling,
+	     getLatency());
 }
 
-void VSTPlugin::unloadEffect()
+void VSTPlugin::setDeadline(int budgetPercent, int maxMisses)
 {
-	effectReady = false;
+	std::lock_guard<std::mutex> lock(processLock);
+	worker.waitIdle();
 
-	if (effect) {
-		effect->dispatcher(effect, effMainsChanged, 0, 0, nullptr, 0);
-		effect->dispatcher(effect, effClose, 0, 0, nullptr, 0.0f);
+	deadlineBudget    = budgetPercent > 0 ? budgetPercent : 0;
+	maxDeadlineMisses = maxMisses > 0 ? maxMisses : 1;
+	consecutiveMisses = 0;
+
+	// Touching the settings gives a bypassed plug-in another chance
+	if (watchdogTripped) {
+		watchdogTripped = false;
+		blog(LOG_INFO, "VST Plug-in: watchdog bypass of '%s' lifted", effectName);
+	}
+
+	if (deadlineBudget && !worker.isStarted()) {
+		worker.start(processJob_static, this);
+	} else if (!deadlineBudget && worker.isStarted()) {
+		worker.stop();
 	}
+}
 
-	effect = nullptr;
+void VSTPlugin::setSmoothingTime(int milliseconds)
+{
+	std::lock_guard<std::mutex> lock(processLock);
+	worker.waitIdle();
 
-	unloadLibrary();
+	smoothingTime = milliseconds > 0 ? milliseconds : 0;
+	smoother.setRampFrames(smoothingTime * (int)sampleRate / 1000);
 }
 
-bool VSTPlugin::isEditorOpen()
+void VSTPlugin::automateParameter(int index, float value)
 {
-	return editorWidget ? true : false;
+	if (!effect || index < 0 || index >= effect->numParams) {
+		return;
+	}
+
+	if (smoother.isEnabled() && smoother.isRampable(index)) {
+		smoother.setTarget(index, value);
+	} else {
+		setLinkedParameter(index, value);
+	}
 }
 
-void VSTPlugin::openEditor()
+void VSTPlugin::setLinkedParameter(int index, float value)
 {
-	if (effect && !editorWidget) {
-		// This check logic is refer to open source project : Audacity
-		if (!(effect->flags & effFlagsHasEditor)) {
-			blog(LOG_WARNING, "VST Plug-in: Can't support edit feature. '%s'", pluginPath.c_str());
-			return;
-		}
+	effect->setParameter(effect, index, value);
+	for (int pair = 0; pair < numPairs; pair++) {
+		pairEffects[pair]->setParameter(pairEffects[pair], index, value);
+	}
+}
 
-		editorOpened = true;
-		editorWidget = new EditorWidget(nullptr, this);
-		editorWidget->buildEffectContainer(effect);
+void VSTPlugin::setStereoPairs(bool enabled)
+{
+	std::lock_guard<std::mutex> lock(processLock);
+	worker.waitIdle();
 
-		if (sourceName.empty()) {
-			sourceName = "VST 2.x";
-		}
+	if (enabled == stereoPairs) {
+		return;
+	}
 
-		if (filterName.empty()) {
-			editorWidget->setWindowTitle(QString("%1 - %2").arg(sourceName.c_str(), effectName));
-		} else {
-			editorWidget->setWindowTitle(
-			        QString("%1:%2 - %3").arg(sourceName.c_str(), filterName.c_str(), effectName));
-		}
-		editorWidget->show();
+	stereoPairs = enabled;
+	if (!effect || !effectReady) {
+		return;
+	}
+
+	destroyPairs();
+	configureRouting();
+	if (stereoPairs) {
+		createPairs();
 	}
+	limitRouting();
 }
 
-void VSTPlugin::closeEditor()
+void VSTPlugin::setDoublePrecision(bool enabled)
 {
-	if (editorWidget) {
-		if (effect && editorOpened) {
-			editorOpened = false;
-			effect->dispatcher(effect, effEditClose, 0, 0, nullptr, 0);
+	std::lock_guard<std::mutex> lock(processLock);
+	worker.waitIdle();
+
+	if (enabled == doublePrecision) {
+		return;
+	}
+
+	doublePrecision = enabled;
+	doubleTime      = 0;
+	doubleBlocks    = 0;
+
+	if (effect && effectReady) {
+		// The precision may only change while suspended
+		bool wasRunning = running;
+		if (wasRunning) {
+			suspendEffect();
 		}
+		updateProcessingFormat();
+		if (wasRunning) {
+			resumeEffect();
+		}
+	}
+}
 
-		editorWidget->close();
-		editorWidget->deleteLater();
-		editorWidget = nullptr;
+void VSTPlugin::setBlockAccumulation(int frames)
+{
+	std::lock_guard<std::mutex> lock(processLock);
+	worker.waitIdle();
+
+	frames = frames > 0 ? frames : 0;
+	if (frames == accumulationFrames) {
+		return;
+	}
+
+	accumulationFrames = frames;
+	if (!effect || !effectReady) {
+		return;
+	}
+
+	// Block size may only change while suspended
+	bool wasRunning = running;
+	if (wasRunning) {
+		suspendEffect();
 	}
+	updateProcessingFormat();
+	if (wasRunning) {
+		resumeEffect();
+	}
+
+	blog(LOG_INFO,
+	     "VST Plug-in: '%s' processes blocks of %d frames, latency %.1f frames",
+	     effectName,
+	     getEffectBlockSize(),
+	     getLatency());
 }
 
-intptr_t VSTPlugin::hostCallback(AEffect *effect, int32_t opcode, int32_t index, intptr_t value, void *ptr, float opt)
+void VSTPlugin::setRouting(const char *inputs, const char *outputs)
 {
-	UNUSED_PARAMETER(effect);
-	UNUSED_PARAMETER(ptr);
-	UNUSED_PARAMETER(opt);
+	std::lock_guard<std::mutex> lock(processLock);
+	worker.waitIdle();
 
-	intptr_t result = 0;
+	if (inputRouting == inputs && outputRouting == outputs) {
+		return;
+	}
 
-	switch (opcode) {
-	case audioMasterSizeWindow:
-		// index: width, value: height
-		if (editorWidget) {
-			editorWidget->handleResizeRequest(index, value);
-		}
-		return 0;
+	inputRouting  = inputs;
+	outputRouting = outputs;
+	applyRouting();
+}
+
+void VSTPlugin::setSidechain(const char *sourceName)
+{
+	std::lock_guard<std::mutex> lock(processLock);
+	worker.waitIdle();
+
+	// The key has the same layout as the source, it comes out of the same mix
+	int channels = *sourceName ? getOutputChannels() : 0;
+	sidechain.setSource(sourceName, channels, sampleRate, BLOCK_SIZE);
+
+	if (channels != sidechainChannels) {
+		sidechainChannels = channels;
+		applyRouting();
 	}
+}
 
-	return result;
+void VSTPlugin::updateSidechain()
+{
+	sidechain.update();
 }
 
-std::string VSTPlugin::getChunk()
+// Called with processLock held
+void VSTPlugin::applyRouting()
 {
-	if (!effect) {
-		return "";
+	if (!configureRouting()) {
+		blog(LOG_WARNING,
+		     "VST Plug-in: invalid channel routing '%s' / '%s', mapping the rest straight through",
+		     inputRouting.c_str(),
+		     outputRouting.c_str());
 	}
 
-	if (effect->flags & effFlagsProgramChunks) {
-		void *buf = nullptr;
+	if (!effect || !effectReady) {
+		limitRouting();
+		return;
+	}
 
-		intptr_t chunkSize = effect->dispatcher(effect, effGetChunk, 1, 0, &buf, 0.0);
+	// The arrangement may only change while suspended
+	bool wasRunning = running;
+	if (wasRunning) {
+		suspendEffect();
+	}
 
-		QByteArray data = QByteArray((char *)buf, chunkSize);
-		return QString(data.toBase64()).toStdString();
-	} else {
-		std::vector<float> params;
-		for (int i = 0; i < effect->numParams; i++) {
-			float parameter = effect->getParameter(effect, i);
-			params.push_back(parameter);
-		}
+	destroyPairs();
+	if (!negotiateArrangement()) {
+		effectReady = false;
+		return;
+	}
+	if (stereoPairs) {
+		createPairs();
+	}
+	limitRouting();
 
-		const char *bytes   = reinterpret_cast<const char *>(&params[0]);
-		QByteArray  data    = QByteArray(bytes, (int)(sizeof(float) * params.size()));
-		std::string encoded = QString(data.toBase64()).toStdString();
-		return encoded;
+	if (wasRunning) {
+		resumeEffect();
 	}
 }
 
-void VSTPlugin::setChunk(std::string data)
+// Called with processLock held or before the effect is ready
+bool VSTPlugin::configureRouting()
 {
-	if (!effect) {
+	return routing.configure(inputRouting.c_str(), outputRouting.c_str(), getOutputChannels(), sidechainChannels);
+}
+
+/*
+ * Asks the plug-in for exactly the channels the routing uses, which may be
+ * less than OBS has. Plug-ins are free to decline and keep their own I/O, so
+ * what counts afterwards is numInputs and numOutputs.
+ * Called with processLock held or before the effect is ready, suspended.
+ */
+bool VSTPlugin::negotiateArrangement()
+{
+	// Instruments have no inputs to arrange
+	int inputs = effect->numInputs ? routing.getInputs() : 0;
+	fillArrangement(inputArrangement, inputs, inputs - routing.getSidechainInputs());
+	fillArrangement(outputArrangement, routing.getOutputs(), routing.getOutputs());
+
+	intptr_t accepted = effect->dispatcher(
+	        effect, effSetSpeakerArrangement, 0, (intptr_t)&inputArrangement, &outputArrangement, 0.0f);
+
+	blog(LOG_INFO,
+	     "VST Plug-in: '%s' %s %d in / %d out, runs with %d inputs and %d outputs",
+	     effectName,
+	     accepted ? "accepted" : "declined",
+	     inputArrangement.numChannels,
+	     outputArrangement.numChannels,
+	     effect->numInputs,
+	     effect->numOutputs);
+
+	// The channel arrays handed to processReplacing have no more entries
+	if (effect->numInputs > VST_MAX_CHANNELS || effect->numOutputs > VST_MAX_CHANNELS) {
+		blog(LOG_WARNING,
+		     "VST Plug-in: '%s' has more than %d inputs or outputs and can't be used",
+		     effectName,
+		     VST_MAX_CHANNELS);
+		return false;
+	}
+
+	return true;
+}
+
+// Called with processLock held or before the effect is ready, after createPairs()
+void VSTPlugin::limitRouting()
+{
+	if (effect) {
+		// Every extra pair adds two channels behind the main instance
+		int pluginInputs  = numPairs ? 2 * (numPairs + 1) : effect->numInputs;
+		int pluginOutputs = numPairs ? 2 * (numPairs + 1) : effect->numOutputs;
+		routing.limit(pluginInputs, pluginOutputs);
+	}
+
+	int used = routing.getInputs() > routing.getOutputs() ? routing.getInputs() : routing.getOutputs();
+	for (int channel = 0; channel < VST_MAX_CHANNELS; channel++) {
+		routedAudio.data[channel] = channel < used ? (uint8_t *)routedMixes[channel] : nullptr;
+	}
+}
+
+// Called with processLock held or before the effect is ready, with the
+// routing configured but not yet limited
+void VSTPlugin::createPairs()
+{
+	// Pairs nobody routes anything to or from would only burn CPU
+	int channels = routing.getInputs() > routing.getOutputs() ? routing.getInputs() : routing.getOutputs();
+
+	if (channels <= 2 || !mainEntry) {
+		return;
+	}
+	if (effect->numInputs > 2 || effect->numOutputs != 2) {
+		blog(LOG_INFO, "VST Plug-in: '%s' is not a stereo plug-in, not split into pairs", effectName);
 		return;
 	}
 
-	if (effect->flags & effFlagsProgramChunks) {
-		QByteArray base64Data = QByteArray(data.c_str(), (int)data.length());
-		QByteArray chunkData  = QByteArray::fromBase64(base64Data);
-		void *     buf        = nullptr;
-		buf                   = chunkData.data();
-		effect->dispatcher(effect, effSetChunk, 1, chunkData.length(), buf, 0);
-	} else {
-		QByteArray base64Data = QByteArray(data.c_str(), (int)data.length());
-		QByteArray paramData  = QByteArray::fromBase64(base64Data);
+	for (int pair = 0; pair < (channels + 1) / 2 - 1; pair++) {
+		AEffect *pairEffect = mainEntry(hostCallback_static);
+		if (!pairEffect || pairEffect->magic != kEffectMagic) {
+			blog(LOG_WARNING, "VST Plug-in: could not create another instance of '%s'", effectName);
+			break;
+		}
 
-		const char * p_chars  = paramData.data();
-		const float *p_floats = reinterpret_cast<const float *>(p_chars);
+		pairEffect->user = this;
+		pairEffect->dispatcher(pairEffect, effOpen, 0, 0, nullptr, 0.0f);
+		setEffectFormat(pairEffect);
 
-		int size = paramData.length() / sizeof(float);
+		pairEffects[pair]     = pairEffect;
+		pairJobs[pair].plugin = this;
+		pairJobs[pair].effect = pairEffect;
+		pairWorkers[pair].start(pairJob_static, &pairJobs[pair]);
+		numPairs++;
 
-		std::vector<float> params(p_floats, p_floats + size);
+		if (running) {
+			pairEffect->dispatcher(pairEffect, effMainsChanged, 0, 1, nullptr, 0.0f);
+			pairEffect->dispatcher(pairEffect, effStartProcess, 0, 0, nullptr, 0.0f);
+		}
+	}
 
-		if (params.size() != (size_t)effect->numParams) {
-			return;
+	clonePairState();
+	smoother.setFollowers(pairEffects, numPairs);
+	automatedPairs = numPairs;
+
+	blog(LOG_INFO, "VST Plug-in: running '%s' as %d stereo pairs", effectName, numPairs + 1);
+}
+
+// Called with processLock held or before the effect is ready
+void VSTPlugin::destroyPairs()
+{
+	smoother.setFollowers(nullptr, 0);
+
+	automatedPairs = 0;
+	while (automating) {
+		os_sleep_ms(0);
+	}
+
+	for (int pair = 0; pair < numPairs; pair++) {
+		AEffect *pairEffect = pairEffects[pair];
+
+		pairWorkers[pair].stop();
+		if (running) {
+			pairEffect->dispatcher(pairEffect, effStopProcess, 0, 0, nullptr, 0.0f);
+			pairEffect->dispatcher(pairEffect, effMainsChanged, 0, 0, nullptr, 0.0f);
 		}
+		pairEffect->dispatcher(pairEffect, effClose, 0, 0, nullptr, 0.0f);
+		pairEffects[pair] = nullptr;
+	}
 
+	numPairs = 0;
+}
+
+// Called with processLock held
+void VSTPlugin::clonePairState()
+{
+	if (!numPairs) {
+		return;
+	}
+
+	std::unique_lock<std::mutex> editorCalls = lockEditorCalls();
+	if (!(effect->flags & effFlagsProgramChunks)) {
 		for (int i = 0; i < effect->numParams; i++) {
-			effect->setParameter(effect, i, params[i]);
+			float value = effect->getParameter(effect, i);
+			for (int pair = 0; pair < numPairs; pair++) {
+				pairEffects[pair]->setParameter(pairEffects[pair], i, value);
+			}
 		}
+		return;
+	}
+
+	// The chunk stays owned by the plug-in and may change with the next call
+	void *   buf  = nullptr;
+	intptr_t size = effect->dispatcher(effect, effGetChunk, 1, 0, &buf, 0.0f);
+	if (!buf || size <= 0) {
+		return;
+	}
+
+	std::vector<char> chunk((char *)buf, (char *)buf + size);
+	for (int pair = 0; pair < numPairs; pair++) {
+		pairEffects[pair]->dispatcher(pairEffects[pair], effSetChunk, 1, size, chunk.data(), 0.0f);
 	}
 }
 
-void VSTPlugin::setProgram(const int programNumber)
+void VSTPlugin::setFlightRecorder(int seconds)
 {
-	if (programNumber < effect->numPrograms) {
-		effect->dispatcher(effect, effSetProgram, 0, programNumber, NULL, 0.0f);
-	} else {
-		blog(LOG_ERROR, "Failed to load program, number was outside possible program range.");
+	std::lock_guard<std::mutex> lock(processLock);
+	worker.waitIdle();
+
+	recorder.configure(seconds, host->getChannels(), sampleRate);
+}
+
+void VSTPlugin::dumpFlightRecorder()
+{
+	recorder.requestDump(FlightRecorder::Manual);
+}
+
+void VSTPlugin::suspendEffect()
+{
+	effect->dispatcher(effect, effStopProcess, 0, 0, nullptr, 0.0f);
+	effect->dispatcher(effect, effMainsChanged, 0, 0, nullptr, 0.0f);
+	for (int pair = 0; pair < numPairs; pair++) {
+		pairEffects[pair]->dispatcher(pairEffects[pair], effStopProcess, 0, 0, nullptr, 0.0f);
+		pairEffects[pair]->dispatcher(pairEffects[pair], effMainsChanged, 0, 0, nullptr, 0.0f);
 	}
+	running = false;
 }
 
-int VSTPlugin::getProgram()
+void VSTPlugin::resumeEffect()
 {
-	return effect->dispatcher(effect, effGetProgram, 0, 0, NULL, 0.0f);
+	// Start from a clean state, nothing from before the suspension leaks out
+	oversampler.reset();
+	rateConverter.reset();
+	accumulator.reset();
+	meter.reset();
+	smoother.reset();
+	midiQueue.clear();
+	nextBlockTimestamp = 0;
+
+	effect->dispatcher(effect, effMainsChanged, 0, 1, nullptr, 0.0f);
+	effect->dispatcher(effect, effStartProcess, 0, 0, nullptr, 0.0f);
+	for (int pair = 0; pair < numPairs; pair++) {
+		pairEffects[pair]->dispatcher(pairEffects[pair], effMainsChanged, 0, 1, nullptr, 0.0f);
+		pairEffects[pair]->dispatcher(pairEffects[pair], effStartProcess, 0, 0, nullptr, 0.0f);
+	}
+	running = true;
+}
+
+void VSTPlugin::updateSuspension()
+{
+	std::lock_guard<std::mutex> lock(processLock);
+	worker.waitIdle();
+
+	if (!effect || !effectReady) {
+		return;
+	}
+
+	bool shouldRun = filterEnabled && targetActive;
+	if (shouldRun && !running) {
+		resumeEffect();
+		blog(LOG_INFO, "VST Plug-in: resumed '%s'", effectName);
+	} else if (!shouldRun && running) {
+		suspendEffect();
+		blog(LOG_INFO, "VST Plug-in: suspended '%s'", effectName);
+	}
+}
+
+void VSTPlugin::setEnabled(bool enabled)
+{
+	filterEnabled = enabled;
+	updateSuspension();
+}
+
+void VSTPlugin::setTargetActive(bool active)
+{
+	targetActive = active;
+	updateSuspension();
+}
+
+size_t VSTPlugin::sanitizeOutputs(float **planes, struct obs_audio_data *audio, uint frames)
+{
+	size_t invalid = 0;
+	for (size_t c = 0; c < VST_MAX_CHANNELS; c++) {
+		if (audio->data[c]) {
+			invalid += simdSanitize(planes[c], frames);
+		}
+	}
+	return invalid;
 }
 
-void VSTPlugin::getSourceNames()
+void VSTPlugin::handleInvalidOutput(size_t invalid)
 {
-	/* Only call inside the vst_filter_audio function! */
-	sourceName = obs_source_get_name(obs_filter_get_target(sourceContext));
-	filterName = obs_source_get_name(sourceContext);
+	if (!invalid) {
+		consecutiveFaults = 0;
+		return;
+	}
+
+	invalidSamples += invalid;
+	invalidPasses++;
+	recorder.requestDump(FlightRecorder::InvalidOutput);
+
+	if (++consecutiveFaults < SANITIZER_RESET_PASSES || !resetOnInvalidOutput) {
+		return;
+	}
+
+	// Whatever state produced the garbage goes away with a suspend/resume cycle
+	consecutiveFaults = 0;
+	suspendEffect();
+	resumeEffect();
+	pluginResets++;
+
+	blog(LOG_WARNING, "VST Plug-in: '%s' kept producing invalid samples and was reset", effectName);
+}
+
+size_t VSTPlugin::runEffect(float **in, float **out, struct obs_audio_data *audio, uint frames)
+{
+	if (oversampler.getFactor() > 1) {
+		return processOversampled(in, out, audio, frames);
+	}
+
+	silenceChannel(out, VST_MAX_CHANNELS, frames);
+	processBlocks(in, out, frames);
+	return sanitizeOutputs(out, audio, frames);
+}
+
+size_t VSTPlugin::processOversampled(float **in, float **out, struct obs_audio_data *audio, uint frames)
+{
+	uint     factor = oversampler.getFactor();
+	uint64_t start  = os_gettime_ns();
+
+	for (size_t c = 0; c < VST_MAX_CHANNELS; c++) {
+		if (audio->data[c]) {
+			oversampler.upsample(c, in[c], frames);
+		}
+	}
+
+	uint64_t upsampled = os_gettime_ns();
+
+	silenceChannel(oversampler.getHighOutputs(), VST_MAX_CHANNELS, frames * factor);
+	processBlocks(oversampler.getHighInputs(), oversampler.getHighOutputs(), frames * factor);
+
+	// Sanitize before the decimation filters so they never see a NaN
+	size_t   invalid   = sanitizeOutputs(oversampler.getHighOutputs(), audio, frames * factor);
+	uint64_t processed = os_gettime_ns();
+
+	for (size_t c = 0; c < VST_MAX_CHANNELS; c++) {
+		if (audio->data[c]) {
+			oversampler.downsample(c, out[c], frames);
+		}
+	}
+
+	resamplerTime += (upsampled - start) + (os_gettime_ns() - processed);
+	resamplerBlocks++;
+	return invalid;
+}
+
+size_t VSTPlugin::processConverted(float **in, float **out, struct obs_audio_data *audio, uint frames)
+{
+	float *planes[VST_MAX_CHANNELS];
+	for (size_t c = 0; c < VST_MAX_CHANNELS; c++) {
+		planes[c] = audio->data[c] ? in[c] : nullptr;
+	}
+
+	uint64_t start          = os_gettime_ns();
+	int      internalFrames = rateConverter.convertInput(planes, frames);
+	uint64_t converted      = os_gettime_ns();
+
+	size_t invalid = runEffect(
+	        rateConverter.getInternalInputs(), rateConverter.getInternalOutputs(), audio, internalFrames);
+
+	uint64_t processed = os_gettime_ns();
+
+	for (size_t c = 0; c < VST_MAX_CHANNELS; c++) {
+		planes[c] = audio->data[c] ? out[c] : nullptr;
+	}
+	rateConverter.convertOutput(planes, internalFrames, frames);
+
+	converterTime += (converted - start) + (os_gettime_ns() - processed);
+	converterBlocks++;
+	return invalid;
+}
+
+bool VSTPlugin::queueMidi(uint8_t status, uint8_t data1, uint8_t data2)
+{
+	if (!acceptsMidi) {
+		return false;
+	}
+
+	// Stamped at 0 to play at the start of the next pass. Packet timestamps
+	// trail the wall clock by OBS's audio buffering, and in the renderer
+	// they don't follow it at all, so os_gettime_ns() was often never due.
+	return midiQueue.push(0, status, data1, data2);
+}
+
+void VSTPlugin::deliverEvents(uint64_t start, uint64_t end, int effectFrames)
+{
+	// Offsets are in plug-in frames, which differ from OBS frames when
+	// converting or oversampling
+	VstEvents *events = midiQueue.collect(start, end, effectFrames > 0 ? effectFrames : 1);
+	if (events) {
+		effect->dispatcher(effect, effProcessEvents, 0, 0, events, 0.0f);
+		for (int pair = 0; pair < numPairs; pair++) {
+			pairEffects[pair]->dispatcher(pairEffects[pair], effProcessEvents, 0, 0, events, 0.0f);
+		}
+	}
+}
+
+void VSTPlugin::processPass(float **adata, struct obs_audio_data *audio, uint frames, uint64_t timestamp)
+{
+	size_t invalid = 0;
+	uint   offset  = 0;
+
+	// From here on channels are plug-in channels, fed through the routing
+	float *routed[VST_MAX_CHANNELS];
+	if (!routing.isPassthrough()) {
+		float *channels[2 * VST_MAX_CHANNELS] = {};
+		for (size_t c = 0; c < VST_MAX_CHANNELS; c++) {
+			channels[c] = adata[c];
+			routed[c]   = inputs[c];
+		}
+		if (routing.getSidechainInputs()) {
+			sidechain.read(channels + ROUTING_SIDECHAIN, frames, timestamp);
+		}
+
+		routing.routeInputs(channels, routedMixes, routed, frames);
+		adata = routed;
+		audio = &routedAudio;
+	}
+
+	/*
+	 * While parameters ramp the pass is cut into short sub-blocks with the
+	 * values stepped in between. Once they settle the rest of the pass runs
+	 * in one go again, so smoothing only costs anything during a transition.
+	 *
+	 * With the accumulator on the plug-in runs on whole blocks that straddle
+	 * passes, so processBlocks() does this per block instead.
+	 */
+	bool perBlock = accumulator.isActive();
+	passTimestamp = timestamp;
+
+	while (offset < frames) {
+		uint count = frames - offset;
+		if (!perBlock) {
+			smoother.update(effect);
+		}
+		if (!perBlock && smoother.isRamping()) {
+			count = count < SMOOTHING_BLOCK_SIZE ? count : SMOOTHING_BLOCK_SIZE;
+			smoother.advance(effect, count);
+			subBlocks++;
+		}
+
+		float *in[VST_MAX_CHANNELS];
+		float *out[VST_MAX_CHANNELS];
+		for (size_t c = 0; c < VST_MAX_CHANNELS; c++) {
+			in[c]  = adata[c] + offset;
+			out[c] = outputs[c] + offset;
+		}
+
+		if (!perBlock) {
+			uint64_t start = timestamp + (uint64_t)offset * 1000000000ULL / sampleRate;
+			uint64_t end   = start + (uint64_t)count * 1000000000ULL / sampleRate;
+			updateTimeInfo(start, end);
+			if (acceptsMidi) {
+				deliverEvents(start, end, (int)((double)count * getEffectSampleRate() / sampleRate));
+			}
+		}
+
+		if (rateConverter.isActive()) {
+			invalid += processConverted(in, out, audio, count);
+		} else {
+			invalid += runEffect(in, out, audio, count);
+		}
+
+		offset += count;
+	}
+
+	passInvalid = (uint32_t)invalid;
+	handleInvalidOutput(invalid);
+}
+
+void VSTPlugin::pairJob_static(void *param)
+{
+	PairJob *job = static_cast<PairJob *>(param);
+
+	inAudioProcess = true;
+	ScopedFlushDenormals flushDenormals;
+	RealtimeAuditScope   audit(job->plugin->effectName);
+	if (job->plugin->processDouble) {
+		TraceScope trace("processDoubleReplacing", job->plugin->effectName);
+		job->effect->processDoubleReplacing(job->effect, job->doubleIn, job->doubleOut, job->frames);
+	} else {
+		TraceScope trace("processReplacing", job->plugin->effectName);
+		job->effect->processReplacing(job->effect, job->in, job->out, job->frames);
+	}
+}
+
+void VSTPlugin::processEffects(float **in, float **out, uint frames)
+{
+	int inputChannels;
+	int outputChannels;
+	getEffectChannels(inputChannels, outputChannels);
+
+	uint64_t start = 0;
+	if (processDouble) {
+		start = os_gettime_ns();
+		for (int c = 0; c < inputChannels; c++) {
+			simdFloatToDouble(doubleInputs[c], in[c], frames);
+		}
+	}
+	uint64_t widened = processDouble ? os_gettime_ns() : 0;
+
+	// The extra pairs start first and run alongside the main instance
+	for (int pair = 0; pair < numPairs; pair++) {
+		pairJobs[pair].in        = in + 2 * (pair + 1);
+		pairJobs[pair].out       = out + 2 * (pair + 1);
+		pairJobs[pair].doubleIn  = doubleInputs ? doubleInputs + 2 * (pair + 1) : nullptr;
+		pairJobs[pair].doubleOut = doubleOutputs ? doubleOutputs + 2 * (pair + 1) : nullptr;
+		pairJobs[pair].frames    = frames;
+		pairWorkers[pair].post();
+	}
+
+	uint64_t called = os_gettime_ns();
+	{
+		RealtimeAuditScope audit(effectName);
+		if (processDouble) {
+			TraceScope trace("processDoubleReplacing", effectName);
+			effect->processDoubleReplacing(effect, doubleInputs, doubleOutputs, frames);
+		} else {
+			TraceScope trace("processReplacing", effectName);
+			effect->processReplacing(effect, in, out, frames);
+		}
+	}
+
+	for (int pair = 0; pair < numPairs; pair++) {
+		pairWorkers[pair].waitIdle();
+	}
+	effectTime += os_gettime_ns() - called;
+
+	if (processDouble) {
+		uint64_t processed = os_gettime_ns();
+		for (int c = 0; c < outputChannels; c++) {
+			simdDoubleToFloat(out[c], doubleOutputs[c], frames);
+		}
+		doubleTime += (widened - start) + (os_gettime_ns() - processed);
+		doubleBlocks++;
+	}
+}
+
+void VSTPlugin::processBlocks(float **in, float **out, uint frames)
+{
+	if (!accumulator.isActive()) {
+		processEffects(in, out, frames);
+		return;
+	}
+
+	int inputChannels;
+	int outputChannels;
+	getEffectChannels(inputChannels, outputChannels);
+
+	// Channels the plug-in never sees are not worth the copies
+	float *planes[VST_MAX_CHANNELS];
+	for (int c = 0; c < VST_MAX_CHANNELS; c++) {
+		planes[c] = c < inputChannels ? in[c] : nullptr;
+	}
+
+	/*
+	 * A block starts with whatever earlier passes left in the accumulator,
+	 * so its time window begins that many frames before this pass. Time
+	 * info, MIDI offsets and parameter ramps all follow the blocks.
+	 */
+	double   rate       = getEffectSampleRate();
+	int      blockSize  = accumulator.getBlockSize();
+	uint64_t blockSpan  = (uint64_t)(blockSize * 1000000000.0 / rate);
+	uint64_t pending    = (uint64_t)(accumulator.getPending() * 1000000000.0 / rate);
+	uint64_t blockStart = passTimestamp > pending ? passTimestamp - pending : 0;
+	uint     hostFrames = (uint)(blockSize * (double)sampleRate / rate);
+
+	accumulator.write(planes, frames);
+
+	while (accumulator.nextBlock()) {
+		uint64_t blockEnd = blockStart + blockSpan;
+
+		smoother.update(effect);
+		if (smoother.isRamping()) {
+			smoother.advance(effect, hostFrames > 0 ? hostFrames : 1);
+			subBlocks++;
+		}
+		updateTimeInfo(blockStart, blockEnd);
+		if (acceptsMidi) {
+			deliverEvents(blockStart, blockEnd, blockSize);
+		}
+
+		processEffects(accumulator.getInputs(), accumulator.getOutputs(), accumulator.getBlockSize());
+		accumulator.finishBlock();
+		blockStart = blockEnd;
+	}
+
+	for (int c = 0; c < VST_MAX_CHANNELS; c++) {
+		planes[c] = c < outputChannels ? out[c] : nullptr;
+	}
+	accumulator.read(planes, frames);
+}
+
+void VSTPlugin::processJob_static(void *param)
+{
+	VSTPlugin *plugin = static_cast<VSTPlugin *>(param);
+
+	inAudioProcess = true;
+	ScopedFlushDenormals flushDenormals;
+	RealtimeAuditScope   audit(HOST_AUDIT_OWNER);
+	plugin->processPass(plugin->jobPlanes, &plugin->jobAudio, plugin->jobFrames, plugin->jobTimestamp);
+	inAudioProcess = false;
+}
+
+bool VSTPlugin::processWatched(float **adata, struct obs_audio_data *audio, uint frames, uint64_t timestamp)
+{
+	// An earlier pass is still running and owns the job buffers and outputs
+	if (worker.isBusy()) {
+		handleMissedDeadline();
+		return false;
+	}
+
+	for (size_t c = 0; c < VST_MAX_CHANNELS; c++) {
+		if (audio->data[c]) {
+			memcpy(jobInputs[c], adata[c], frames * sizeof(float));
+			jobPlanes[c]     = jobInputs[c];
+			jobAudio.data[c] = (uint8_t *)jobInputs[c];
+		} else {
+			jobPlanes[c]     = inputs[c];
+			jobAudio.data[c] = nullptr;
+		}
+	}
+	jobAudio.frames = frames;
+	jobFrames       = frames;
+	jobTimestamp    = timestamp;
+
+	uint64_t deadline = (uint64_t)frames * 1000000000ULL / sampleRate * deadlineBudget / 100;
+	if (worker.run(deadline) != DeadlineWorker::Finished) {
+		handleMissedDeadline();
+		return false;
+	}
+
+	consecutiveMisses = 0;
+	return true;
+}
+
+void VSTPlugin::handleMissedDeadline()
+{
+	deadlineMisses++;
+	recorder.requestDump(FlightRecorder::DeadlineMiss);
+
+	if (++consecutiveMisses < maxDeadlineMisses || watchdogTripped) {
+		return;
+	}
+
+	watchdogTripped = true;
+	watchdogTrips++;
+
+	blog(LOG_WARNING,
+	     "VST Plug-in: '%s' missed its deadline %d times in a row and is bypassed",
+	     effectName,
+	     consecutiveMisses);
+}
+
+void VSTPlugin::recordPass(float **adata, uint frames, uint64_t timestamp, uint64_t startTime, bool processed)
+{
+	if (!recorder.isEnabled()) {
+		return;
+	}
+
+	FlightRecorder::PassInfo info = {};
+	info.timestamp                = timestamp;
+	info.processTime              = os_gettime_ns() - startTime;
+	info.frames                   = frames;
+	info.invalid                  = processed ? passInvalid : 0;
+	info.missed                   = !processed;
+
+	// adata still holds the input here, a missed pass was passed through dry
+	recorder.record(adata, processed ? outputs : adata, info, processed ? effect : nullptr);
+}
+
+/*
+ * One packet, cut into passes of BLOCK_SIZE frames. Channels is the number of
+ * OBS planes, which are then known to be the first ones, 0 is the generic
+ * version for any layout. With FullBlocks the packet is a multiple of
+ * BLOCK_SIZE and every pass is a full block.
+ */
+template<int Channels, bool FullBlocks>
+void VSTPlugin::processPacket(struct obs_audio_data *audio)
+{
+	uint passes = FullBlocks ? audio->frames / BLOCK_SIZE : (audio->frames + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	for (uint pass = 0; pass < passes; pass++) {
+		uint frames = BLOCK_SIZE;
+		if (!FullBlocks && pass == passes - 1) {
+			frames = audio->frames - pass * BLOCK_SIZE;
+		}
+
+		float *adata[VST_MAX_CHANNELS];
+		if (Channels) {
+			for (int c = 0; c < Channels; c++) {
+				adata[c] = (float *)audio->data[c] + pass * BLOCK_SIZE;
+			}
+			for (int c = Channels; c < VST_MAX_CHANNELS; c++) {
+				adata[c] = inputs[c];
+			}
+		} else {
+			for (size_t d = 0; d < VST_MAX_CHANNELS; d++) {
+				if (audio->data[d] != nullptr) {
+					adata[d] = ((float *)audio->data[d]) + (pass * BLOCK_SIZE);
+				} else {
+					adata[d] = inputs[d];
+				}
+			}
+		}
+
+		uint64_t offset    = (uint64_t)pass * BLOCK_SIZE * 1000000000ULL / sampleRate;
+		uint64_t startTime = os_gettime_ns();
+		bool     processed = true;
+
+		if (!deadlineBudget) {
+			processPass(adata, audio, frames, audio->timestamp + offset);
+		} else {
+			processed = processWatched(adata, audio, frames, audio->timestamp + offset);
+		}
+
+		uint64_t passTime = os_gettime_ns() - startTime;
+		blockTimes.record(passTime);
+		if (passTime > (uint64_t)frames * 1000000000ULL / sampleRate) {
+			overruns++;
+		}
+
+		recordPass(adata, frames, audio->timestamp + offset, startTime, processed);
+		if (!processed) {
+			// The rest of the packet stays dry
+			break;
+		}
+
+		if (Channels && routing.isPassthrough()) {
+			for (int c = 0; c < Channels; c++) {
+				meter.copy(c, adata[c], outputs[c], frames);
+			}
+			meter.advance(frames);
+		} else {
+			float *targets[VST_MAX_CHANNELS];
+			for (size_t c = 0; c < VST_MAX_CHANNELS; c++) {
+				targets[c] = audio->data[c] ? adata[c] : nullptr;
+			}
+			routing.routeOutputs(outputs, targets, frames, &meter);
+		}
+	}
+}
+
+void VSTPlugin::selectPacketKernel(struct obs_audio_data *audio)
+{
+	uint32_t layout = 0;
+	for (size_t c = 0; c < VST_MAX_CHANNELS; c++) {
+		layout |= audio->data[c] ? 1u << c : 0;
+	}
+
+	if (packetKernel && layout == packetLayout && audio->frames == packetFrames) {
+		return;
+	}
+	packetLayout = layout;
+	packetFrames = audio->frames;
+
+#ifdef VST_GENERIC_PACKET_KERNEL
+	// The baseline of obs-vst-host-bench-generic
+	layout = 0;
+#endif
+
+	// Only layouts that fill the first planes have a specialised kernel
+	bool full        = audio->frames % BLOCK_SIZE == 0;
+	packetFullBlocks = full;
+	switch (layout) {
+	case 0x01:
+		packetKernel     = full ? &VSTPlugin::processPacket<1, true> : &VSTPlugin::processPacket<1, false>;
+		packetKernelName = "mono";
+		break;
+	case 0x03:
+		packetKernel     = full ? &VSTPlugin::processPacket<2, true> : &VSTPlugin::processPacket<2, false>;
+		packetKernelName = "stereo";
+		break;
+	case 0x3f:
+		packetKernel     = full ? &VSTPlugin::processPacket<6, true> : &VSTPlugin::processPacket<6, false>;
+		packetKernelName = "5.1";
+		break;
+	case 0xff:
+		packetKernel     = full ? &VSTPlugin::processPacket<8, true> : &VSTPlugin::processPacket<8, false>;
+		packetKernelName = "7.1";
+		break;
+	default:
+		packetKernel     = full ? &VSTPlugin::processPacket<0, true> : &VSTPlugin::processPacket<0, false>;
+		packetKernelName = "generic";
+		break;
+	}
+}
+
+obs_audio_data *VSTPlugin::process(struct obs_audio_data *audio)
+{
+	// Never wait for the UI thread here, a packet is rather passed through dry
+	std::unique_lock<std::mutex> lock(processLock, std::try_to_lock);
+	if (!lock.owns_lock()) {
+		return audio;
+	}
+
+	inAudioProcess = true;
+
+	// Plug-ins decaying into denormals can cost orders of magnitude more CPU
+	ScopedFlushDenormals flushDenormals;
+
+	// A suspended effect passes audio through untouched
+	if (effect && effectReady && running && !watchdogTripped) {
+		uint64_t start = os_gettime_ns();
+
+		selectPacketKernel(audio);
+		(this->*packetKernel)(audio);
+
+		packetTime += os_gettime_ns() - start;
+		packetBlocks += (audio->frames + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	}
+
+	inAudioProcess = false;
+
+	return audio;
+}
+
+void VSTPlugin::unloadEffect()
+{
+	std::lock_guard<std::mutex> lock(processLock);
+	worker.waitIdle();
+
+	effectReady       = false;
+	acceptsMidi       = false;
+	watchdogTripped   = false;
+	consecutiveMisses = 0;
+
+	if (effect) {
+		if (running) {
+			suspendEffect();
+		}
+		destroyPairs();
+		effect->dispatcher(effect, effClose, 0, 0, nullptr, 0.0f);
+	}
+
+	effect        = nullptr;
+	mainEntry     = nullptr;
+	processDouble = false;
+
+	unloadLibrary();
+}
+
+int VSTPlugin::getOutputChannels() const
+{
+	int channels = host->getChannels();
+	return channels < VST_MAX_CHANNELS ? channels : VST_MAX_CHANNELS;
+}
+
+bool VSTPlugin::isEditorOpen()
+{
+	return editorWidget || editorThreaded;
+}
+
+std::unique_lock<std::mutex> VSTPlugin::lockEditorCalls()
+{
+#ifdef __linux__
+	if (editorThreaded) {
+		return EditorThread::get().lockCalls(effect);
+	}
+#endif
+	// Editors in an EditorWidget run on the UI thread like everything else
+	return std::unique_lock<std::mutex>();
+}
+
+void VSTPlugin::openEditor()
+{
+	TraceScope trace("openEditor", effectName);
+
+	if (effect && !isEditorOpen()) {
+		// This check logic is refer to open source project : Audacity
+		if (!(effect->flags & effFlagsHasEditor)) {
+			blog(LOG_WARNING, "VST Plug-in: Can't support edit feature. '%s'", pluginPath.c_str());
+			return;
+		}
+
+		editorOpened = true;
+		updateSourceNames();
+
+#ifdef __linux__
+		// Own X11 window on the editor thread, so the GUI can't stall OBS
+		if (EditorThread::get().open(this, effect, getEditorTitle())) {
+			editorThreaded = true;
+			return;
+		}
+#endif
+
+		editorWidget = new EditorWidget(nullptr, this);
+		editorWidget->buildEffectContainer(effect);
+		editorWidget->setWindowTitle(QString::fromStdString(getEditorTitle()));
+		editorWidget->show();
+	}
+}
+
+void VSTPlugin::closeEditor()
+{
+	TraceScope trace("closeEditor", effectName);
+
+#ifdef __linux__
+	if (editorThreaded) {
+		EditorThread::get().close(effect);
+		editorClosed();
+		return;
+	}
+#endif
+
+	if (editorWidget) {
+		if (effect && editorOpened) {
+			editorOpened = false;
+			effect->dispatcher(effect, effEditClose, 0, 0, nullptr, 0);
+
+			// Not every edit is announced through audioMasterAutomate
+			std::lock_guard<std::mutex> lock(processLock);
+			worker.waitIdle();
+			clonePairState();
+		}
+
+		editorWidget->close();
+		editorWidget->deleteLater();
+		editorWidget = nullptr;
+	}
+}
+
+void VSTPlugin::editorClosed()
+{
+	// Queued by EditorThread when the user closes the window. By the time it
+	// arrives the editor may have been opened again.
+#ifdef __linux__
+	if (!editorThreaded || EditorThread::get().isOpen(effect)) {
+		return;
+	}
+#endif
+
+	editorThreaded = false;
+	if (effect && editorOpened) {
+		editorOpened = false;
+
+		std::lock_guard<std::mutex> lock(processLock);
+		worker.waitIdle();
+		clonePairState();
+	}
+}
+
+/*
+ * Answers for audioMasterCanDo. Plug-ins may ask from inside
+ * processReplacing, so this is a constant table that needs neither
+ * allocation nor locking to look up: 1 means yes, -1 no.
+ */
+static const struct {
+	const char *name;
+	intptr_t    answer;
+} hostCapabilities[] = {
+        {"sendVstTimeInfo", 1},
+        {"sizeWindow", 1},
+        {"sendVstEvents", 1},
+        {"sendVstMidiEvent", 1},
+        {"receiveVstEvents", -1},
+        {"receiveVstMidiEvent", -1},
+        {"reportConnectionChanges", -1},
+        {"acceptIOChanges", -1},
+        {"startStopProcess", 1},
+        {"offline", -1},
+        {"openFileSelector", -1},
+        {"closeFileSelector", -1},
+        {"editFile", -1},
+        {"shellCategory", -1},
+};
+
+static intptr_t hostCanDo(const char *capability)
+{
+	if (!capability) {
+		return 0;
+	}
+	for (const auto &entry : hostCapabilities) {
+		if (strcmp(entry.name, capability) == 0) {
+			return entry.answer;
+		}
+	}
+	return 0;
+}
+
+static void copyHostString(void *ptr, const char *string)
+{
+	// Plug-ins pass a buffer of kVstMaxVendorStrLen (64) characters
+	if (ptr) {
+		strncpy((char *)ptr, string, 63);
+		((char *)ptr)[63] = '\0';
+	}
+}
+
+void VSTPlugin::updateTimeInfo(uint64_t timestamp, uint64_t end)
+{
+	/*
+	 * OBS has no transport, so the song position simply follows the audio
+	 * timestamps at a fixed tempo. Every filter on the same timeline sees
+	 * the same position, and a jump in the timestamps is reported as a
+	 * transport change so tempo-synced effects can resync.
+	 */
+	double  rate    = getEffectSampleRate();
+	double  seconds = timestamp / 1000000000.0;
+	double  ppq     = seconds * HOST_TEMPO / 60.0;
+	int64_t drift   = (int64_t)(timestamp - nextBlockTimestamp);
+	bool    jumped  = nextBlockTimestamp == 0 || llabs(drift) > 1000000;
+
+	int flags = kVstNanosValid | kVstPpqPosValid | kVstTempoValid | kVstBarsValid | kVstTimeSigValid;
+	flags |= kVstTransportPlaying;
+	if (jumped) {
+		flags |= kVstTransportChanged;
+	}
+
+	timeInfo.samplePos          = seconds * rate;
+	timeInfo.sampleRate         = rate;
+	timeInfo.nanoSeconds        = (double)timestamp;
+	timeInfo.ppqPos             = ppq;
+	timeInfo.tempo              = HOST_TEMPO;
+	timeInfo.barStartPos        = floor(ppq / 4.0) * 4.0;
+	timeInfo.cycleStartPos      = 0.0;
+	timeInfo.cycleEndPos        = 0.0;
+	timeInfo.timeSigNumerator   = 4;
+	timeInfo.timeSigDenominator = 4;
+	timeInfo.flags              = flags;
+
+	nextBlockTimestamp = end;
+}
+
+intptr_t VSTPlugin::hostCallback(AEffect *effect, int32_t opcode, int32_t index, intptr_t value, void *ptr, float opt)
+{
+	intptr_t result = 0;
+
+	// Nothing in here may allocate or lock, it is called from processReplacing
+	RealtimeAuditScope audit(inAudioProcess ? HOST_AUDIT_OWNER : nullptr);
+
+	switch (opcode) {
+	case audioMasterVersion:
+		return (intptr_t)2400;
+
+	case audioMasterCurrentId:
+		return effect ? effect->uniqueID : 0;
+
+	case audioMasterWantMidi:
+		return 1;
+
+	case audioMasterAutomate:
+		// Edits in the main instance's editor, the extra pairs follow them.
+		// The editor thread does not hold processLock, see destroyPairs().
+		if (effect == this->effect) {
+			automating++;
+			int pairs = automatedPairs;
+			for (int pair = 0; pair < pairs; pair++) {
+				pairEffects[pair]->setParameter(pairEffects[pair], index, opt);
+			}
+			automating--;
+		}
+		return 0;
+
+	case audioMasterGetSpeakerArrangement:
+		// value: input, ptr: output, both point to an arrangement pointer
+		if (value && ptr) {
+			*(VstSpeakerArrangement **)value = &inputArrangement;
+			*(VstSpeakerArrangement **)ptr   = &outputArrangement;
+			return 1;
+		}
+		return 0;
+
+	case audioMasterProcessEvents:
+		// Events sent back by the plug-in are not routed anywhere
+		return 0;
+
+	case audioMasterGetTime:
+		return (intptr_t)&timeInfo;
+
+	case audioMasterGetSampleRate:
+		return (intptr_t)getEffectSampleRate();
+
+	case audioMasterGetBlockSize:
+		return (intptr_t)getEffectBlockSize();
+
+	case audioMasterGetInputLatency:
+	case audioMasterGetOutputLatency:
+		return 0;
+
+	case audioMasterGetCurrentProcessLevel:
+		return inAudioProcess ? kVstProcessLevelRealtime : kVstProcessLevelUser;
+
+	case audioMasterGetAutomationState:
+		return kVstAutomationOff;
+
+	case audioMasterWillReplaceOrAccumulate:
+		// 1 = replace
+		return 1;
+
+	case audioMasterCanDo:
+		return hostCanDo((const char *)ptr);
+
+	case audioMasterGetVendorString:
+		copyHostString(ptr, HOST_VENDOR_STRING);
+		return 1;
+
+	case audioMasterGetProductString:
+		copyHostString(ptr, HOST_PRODUCT_STRING);
+		return 1;
+
+	case audioMasterGetVendorVersion:
+		return HOST_VENDOR_VERSION;
+
+	case audioMasterGetLanguage:
+		return kVstLangEnglish;
+
+	case audioMasterSizeWindow:
+		// index: width, value: height
+		if (editorWidget) {
+			TraceScope trace("resizeEditor", effectName);
+			editorWidget->handleResizeRequest(index, value);
+		}
+#ifdef __linux__
+		if (editorThreaded) {
+			EditorThread::get().resize(effect, index, (int)value);
+		}
+#endif
+		return 0;
+	}
+
+	return result;
+}
+
+std::string VSTPlugin::getChunk()
+{
+	TraceScope trace("getChunk", effectName);
+
+	if (!effect) {
+		return "";
+	}
+
+	// Encoded straight from the plug-in's buffer into the string
+	std::unique_lock<std::mutex> editorCalls = lockEditorCalls();
+	std::string                  encoded;
+	if (effect->flags & effFlagsProgramChunks) {
+		void *buf = nullptr;
+
+		intptr_t chunkSize = effect->dispatcher(effect, effGetChunk, 1, 0, &buf, 0.0);
+		if (!buf || chunkSize <= 0) {
+			return "";
+		}
+
+		encoded.resize(base64EncodedLength(chunkSize));
+		base64Encode((const uint8_t *)buf, chunkSize, &encoded[0]);
+		stateSize = (uint64_t)chunkSize;
+	} else {
+		std::vector<float> params;
+		for (int i = 0; i < effect->numParams; i++) {
+			float parameter = effect->getParameter(effect, i);
+			params.push_back(parameter);
+		}
+
+		encoded.resize(base64EncodedLength(sizeof(float) * params.size()));
+		base64Encode((const uint8_t *)params.data(), sizeof(float) * params.size(), &encoded[0]);
+		stateSize = sizeof(float) * params.size();
+	}
+	return encoded;
+}
+
+void VSTPlugin::setChunk(const char *data, size_t length)
+{
+	TraceScope trace("setChunk", effectName);
+
+	if (!effect) {
+		return;
+	}
+
+	// Checked before anything is allocated or handed to the plug-in
+	size_t size = 0;
+	if (!base64DecodedLength(data, length, size)) {
+		blog(LOG_WARNING, "VST Plug-in: '%s' chunk data is not valid base64 and was ignored", effectName);
+		return;
+	}
+
+	if (effect->flags & effFlagsProgramChunks) {
+		std::vector<uint8_t> chunkData(size);
+		if (!base64Decode(data, length, chunkData.data())) {
+			blog(LOG_WARNING, "VST Plug-in: '%s' chunk data is not valid base64 and was ignored", effectName);
+			return;
+		}
+		void *buf = chunkData.data();
+		stateSize = size;
+
+		// A chunk makes every parameter jump at once. With smoothing on, the
+		// old values are put back and the plug-in ramps to the new ones.
+		std::unique_lock<std::mutex> lock(processLock, std::defer_lock);
+		std::vector<float>           before;
+		if (smoother.isEnabled() || numPairs) {
+			lock.lock();
+			worker.waitIdle();
+		}
+		std::unique_lock<std::mutex> editorCalls = lockEditorCalls();
+		if (smoother.isEnabled()) {
+			for (int i = 0; i < effect->numParams; i++) {
+				before.push_back(effect->getParameter(effect, i));
+			}
+		}
+
+		effect->dispatcher(effect, effSetChunk, 1, (intptr_t)size, buf, 0);
+		for (int pair = 0; pair < numPairs; pair++) {
+			pairEffects[pair]->dispatcher(pairEffects[pair], effSetChunk, 1, (intptr_t)size, buf, 0);
+		}
+
+		for (int i = 0; i < (int)before.size(); i++) {
+			float after = effect->getParameter(effect, i);
+			if (after != before[i] && smoother.isRampable(i)) {
+				setLinkedParameter(i, before[i]);
+				smoother.setTarget(i, after);
+			}
+		}
+	} else {
+		if (size != sizeof(float) * effect->numParams) {
+			return;
+		}
+
+		std::vector<float> params(effect->numParams);
+		if (!base64Decode(data, length, (uint8_t *)params.data())) {
+			blog(LOG_WARNING, "VST Plug-in: '%s' chunk data is not valid base64 and was ignored", effectName);
+			return;
+		}
+
+		for (int i = 0; i < effect->numParams; i++) {
+			automateParameter(i, params[i]);
+		}
+		stateSize = size;
+	}
+}
+
+double VSTPlugin::getLatency()
+{
+	int factor = oversampler.getFactor();
+
+	// initialDelay is reported at the rate the plug-in runs at
+	double internalDelay = effect ? (double)effect->initialDelay / factor : 0.0;
+	internalDelay += (double)accumulator.getLatency() / factor;
+	internalDelay += oversampler.getLatency();
+
+	return internalDelay * sampleRate / getProcessingRate() + rateConverter.getLatency();
+}
+
+void VSTPlugin::getMetrics(Metrics &metrics)
+{
+	metrics.name        = effect ? effectName : "";
+	metrics.running     = effect && effectReady && running && !watchdogTripped;
+	metrics.processTime = packetTime;
+	metrics.blocks      = packetBlocks;
+	blockTimes.getCounts(metrics.blockTimes);
+	metrics.blockTimeSum   = blockTimes.getSum();
+	metrics.overruns       = overruns;
+	metrics.deadlineMisses = deadlineMisses;
+	metrics.latency        = sampleRate ? getLatency() / sampleRate : 0.0;
+	metrics.stateSize      = stateSize;
+
+	// What the host holds for the instance, the plug-in's own memory is not
+	// visible from here
+	int doubleFrames   = doubleInputs ? getEffectBlockSize() : 0;
+	metrics.hostMemory = 4 * VST_MAX_CHANNELS * BLOCK_SIZE * sizeof(float) +
+	                     2 * VST_MAX_CHANNELS * doubleFrames * sizeof(double) + recorder.getMemoryUsage();
+}
+
+std::string VSTPlugin::getStatistics()
+{
+	char     line[256];
+	uint64_t blocks = resamplerBlocks;
+
+	snprintf(line,
+	         sizeof(line),
+	         "Latency: %.1f frames (%.2f ms)\n",
+	         getLatency(),
+	         sampleRate ? getLatency() * 1000.0 / sampleRate : 0.0);
+	std::string statistics = line;
+
+	LevelMeter::Levels in  = meter.getInput();
+	LevelMeter::Levels out = meter.getOutput();
+	snprintf(line,
+	         sizeof(line),
+	         "Input: peak %.1f dBFS, RMS %.1f dBFS, %.1f LUFS\n"
+	         "Output: peak %.1f dBFS, RMS %.1f dBFS, %.1f LUFS\n",
+	         in.peak,
+	         in.rms,
+	         in.loudness,
+	         out.peak,
+	         out.rms,
+	         out.loudness);
+	statistics += line;
+
+	if (rateConverter.isActive()) {
+		uint64_t converted = converterBlocks;
+		snprintf(line,
+		         sizeof(line),
+		         "Internal rate: %u Hz, converter %.1f us per block\n",
+		         rateConverter.getInternalRate(),
+		         converted ? (double)converterTime / converted / 1000.0 : 0.0);
+		statistics += line;
+	}
+
+	if (oversampler.getFactor() > 1) {
+		snprintf(line,
+		         sizeof(line),
+		         "Oversampling: %dx, resampler %.1f us per block\n",
+		         oversampler.getFactor(),
+		         blocks ? (double)resamplerTime / blocks / 1000.0 : 0.0);
+		statistics += line;
+	}
+
+	uint64_t passes = packetBlocks;
+	if (passes) {
+		uint64_t plugin = effectTime;
+		uint64_t total  = packetTime;
+		snprintf(line,
+		         sizeof(line),
+		         "Host: %.2f us per block outside the plug-in, %s kernel, %s blocks\n",
+		         (double)(total > plugin ? total - plugin : 0) / passes / 1000.0,
+		         packetKernelName.load(),
+		         packetFullBlocks ? "full" : "partial");
+		statistics += line;
+	}
+
+	if (accumulator.isActive()) {
+		snprintf(line,
+		         sizeof(line),
+		         "Block accumulation: %d frames, adds %.1f ms\n",
+		         accumulator.getBlockSize(),
+		         (double)accumulator.getLatency() * 1000.0 / getEffectSampleRate());
+		statistics += line;
+	}
+
+	if (processDouble) {
+		uint64_t widened = doubleBlocks;
+		snprintf(line,
+		         sizeof(line),
+		         "Precision: 64-bit, conversion %.1f us per block\n",
+		         widened ? (double)doubleTime / widened / 1000.0 : 0.0);
+		statistics += line;
+	} else if (doublePrecision && effect) {
+		statistics += "Precision: 32-bit, the plug-in can't process 64-bit\n";
+	}
+
+	snprintf(line,
+	         sizeof(line),
+	         "Invalid samples: %llu in %llu passes, %llu resets\n",
+	         (unsigned long long)invalidSamples,
+	         (unsigned long long)invalidPasses,
+	         (unsigned long long)pluginResets);
+	statistics += line;
+
+	if (recorder.isEnabled()) {
+		snprintf(line,
+		         sizeof(line),
+		         "Flight recorder: %.1f MB, %llu dumps\n",
+		         recorder.getMemoryUsage() / (1024.0 * 1024.0),
+		         (unsigned long long)recorder.getDumps());
+		statistics += line;
+	}
+
+	if (numPairs) {
+		snprintf(line, sizeof(line), "Stereo pairs: %d instances\n", numPairs + 1);
+		statistics += line;
+	}
+
+	if (sidechainChannels) {
+		const SidechainRing &ring = sidechain.getRing();
+		snprintf(line,
+		         sizeof(line),
+		         "Sidechain: %s, %d plug-in inputs, %llu resyncs, %llu late, %llu silent\n",
+		         sidechain.isConnected() ? "connected" : "waiting for source",
+		         routing.getSidechainInputs(),
+		         (unsigned long long)ring.getJumps(),
+		         (unsigned long long)ring.getLateReads(),
+		         (unsigned long long)ring.getSilentReads());
+		statistics += line;
+	}
+
+	if (effect && !routing.isPassthrough()) {
+		snprintf(line,
+		         sizeof(line),
+		         "Routing: %d of %d plug-in inputs, %d of %d outputs\n",
+		         routing.getInputs(),
+		         effect->numInputs,
+		         routing.getOutputs(),
+		         effect->numOutputs);
+		statistics += line;
+	}
+
+	if (smoothingTime) {
+		snprintf(line,
+		         sizeof(line),
+		         "Smoothing: %d ms, %llu ramps, %llu sub-blocks\n",
+		         smoothingTime,
+		         (unsigned long long)smoother.getRamps(),
+		         (unsigned long long)subBlocks);
+		statistics += line;
+	}
+
+	if (acceptsMidi) {
+		snprintf(line,
+		         sizeof(line),
+		         "MIDI events: %llu delivered, %llu dropped\n",
+		         (unsigned long long)midiQueue.getDelivered(),
+		         (unsigned long long)midiQueue.getDropped());
+		statistics += line;
+	}
+
+	if (deadlineBudget) {
+		snprintf(line,
+		         sizeof(line),
+		         "Deadline misses: %llu, bypassed %llu times%s\n",
+		         (unsigned long long)deadlineMisses,
+		         (unsigned long long)watchdogTrips,
+		         watchdogTripped ? " (bypassed now)" : "");
+		statistics += line;
+	}
+
+	return statistics;
+}
+
+void VSTPlugin::setProgram(const int programNumber)
+{
+	if (programNumber < effect->numPrograms) {
+		std::lock_guard<std::mutex> lock(processLock);
+		worker.waitIdle();
+
+		std::unique_lock<std::mutex> editorCalls = lockEditorCalls();
+		effect->dispatcher(effect, effSetProgram, 0, programNumber, NULL, 0.0f);
+		for (int pair = 0; pair < numPairs; pair++) {
+			pairEffects[pair]->dispatcher(pairEffects[pair], effSetProgram, 0, programNumber, NULL, 0.0f);
+		}
+	} else {
+		blog(LOG_ERROR, "Failed to load program, number was outside possible program range.");
+	}
+}
+
+int VSTPlugin::getProgram()
+{
+	std::unique_lock<std::mutex> editorCalls = lockEditorCalls();
+	return effect->dispatcher(effect, effGetProgram, 0, 0, NULL, 0.0f);
+}
+
+void VSTPlugin::setSourceContext(obs_source_t *context)
+{
+	sourceContext = context;
+	QMetaObject::invokeMethod(this, "updateSourceNames");
+}
+
+void VSTPlugin::updateSourceNames()
+{
+	// Called on the UI thread when the editor opens and whenever the filter
+	// or its source is renamed, never from the audio path.
+	const char *source = host->getTargetName(sourceContext);
+	const char *filter = host->getFilterName(sourceContext);
+
+	sourceName = source && *source ? source : "VST 2.x";
+	filterName = filter ? filter : "";
+
+#ifdef __linux__
+	if (editorThreaded) {
+		EditorThread::get().setTitle(effect, getEditorTitle());
+	}
+#endif
+
+	if (editorWidget) {
+		editorWidget->setWindowTitle(QString::fromStdString(getEditorTitle()));
+	}
+}
+
+std::string VSTPlugin::getEditorTitle() const
+{
+	if (filterName.empty()) {
+		return sourceName + " - " + effectName;
+	}
+	return sourceName + ":" + filterName + " - " + effectName;
 }
@@ -0,0 +1,276 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#include "headers/WavFile.h"
+
+#include <util/platform.h>
+#include <string.h>
+
+#define WAVE_FORMAT_PCM 1
+#define WAVE_FORMAT_IEEE_FLOAT 3
+#define WAVE_FORMAT_EXTENSIBLE 0xfffe
+#define WAV_HEADER_SIZE 44
+#define WAV_CHUNK_FRAMES 256
+#define WAV_MAX_CHANNELS 16
+
+static void putLe16(uint8_t *out, uint16_t value)
+{
+	out[0] = (uint8_t)value;
+	out[1] = (uint8_t)(value >> 8);
+}
+
+static void putLe32(uint8_t *out, uint32_t value)
+{
+	putLe16(out, (uint16_t)value);
+	putLe16(out + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t getLe16(const uint8_t *in)
+{
+	return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t getLe32(const uint8_t *in)
+{
+	return getLe16(in) | ((uint32_t)getLe16(in + 2) << 16);
+}
+
+WavWriter::~WavWriter()
+{
+	close();
+}
+
+bool WavWriter::open(const char *path, int numChannels, uint32_t sampleRate)
+{
+	close();
+
+	if (numChannels <= 0 || numChannels > WAV_MAX_CHANNELS) {
+		return false;
+	}
+
+	file = os_fopen(path, "wb");
+	if (!file) {
+		return false;
+	}
+
+	this->numChannels = numChannels;
+	dataBytes         = 0;
+
+	uint16_t blockAlign = (uint16_t)(numChannels * sizeof(float));
+	uint8_t  header[WAV_HEADER_SIZE];
+
+	memcpy(header, "RIFF", 4);
+	putLe32(header + 4, 0);
+	memcpy(header + 8, "WAVEfmt ", 8);
+	putLe32(header + 16, 16);
+	putLe16(header + 20, WAVE_FORMAT_IEEE_FLOAT);
+	putLe16(header + 22, (uint16_t)numChannels);
+	putLe32(header + 24, sampleRate);
+	putLe32(header + 28, sampleRate * blockAlign);
+	putLe16(header + 32, blockAlign);
+	putLe16(header + 34, 32);
+	memcpy(header + 36, "data", 4);
+	putLe32(header + 40, 0);
+
+	return fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+bool WavWriter::write(const float *const *planes, int frames)
+{
+	if (!file) {
+		return false;
+	}
+
+	float interleaved[WAV_CHUNK_FRAMES * WAV_MAX_CHANNELS];
+	int   chunkFrames = (int)(sizeof(interleaved) / sizeof(float)) / numChannels;
+
+	for (int offset = 0; offset < frames; offset += chunkFrames) {
+		int count = frames - offset < chunkFrames ? frames - offset : chunkFrames;
+
+		for (int i = 0; i < count; i++) {
+			for (int channel = 0; channel < numChannels; channel++) {
+				interleaved[i * numChannels + channel] = planes[channel] ? planes[channel][offset + i] : 0.0f;
+			}
+		}
+
+		size_t bytes = count * numChannels * sizeof(float);
+		if (fwrite(interleaved, 1, bytes, file) != bytes) {
+			return false;
+		}
+		dataBytes += (uint32_t)bytes;
+	}
+
+	return true;
+}
+
+bool WavWriter::close()
+{
+	if (!file) {
+		return true;
+	}
+
+	uint8_t size[4];
+	bool    success = true;
+
+	putLe32(size, WAV_HEADER_SIZE - 8 + dataBytes);
+	success &= fseek(file, 4, SEEK_SET) == 0 && fwrite(size, 1, 4, file) == 4;
+	putLe32(size, dataBytes);
+	success &= fseek(file, 40, SEEK_SET) == 0 && fwrite(size, 1, 4, file) == 4;
+	success &= fclose(file) == 0;
+
+	file = nullptr;
+	return success;
+}
+
+WavReader::~WavReader()
+{
+	close();
+}
+
+void WavReader::close()
+{
+	if (file) {
+		fclose(file);
+		file = nullptr;
+	}
+}
+
+bool WavReader::open(const char *path)
+{
+	close();
+
+	file = os_fopen(path, "rb");
+	if (!file) {
+		return false;
+	}
+
+	uint8_t riff[12];
+	if (fread(riff, 1, sizeof(riff), file) != sizeof(riff) || memcmp(riff, "RIFF", 4) != 0 ||
+	    memcmp(riff + 8, "WAVE", 4) != 0) {
+		close();
+		return false;
+	}
+
+	bool haveFormat = false;
+	for (;;) {
+		uint8_t chunk[8];
+		if (fread(chunk, 1, sizeof(chunk), file) != sizeof(chunk)) {
+			close();
+			return false;
+		}
+
+		uint32_t size = getLe32(chunk + 4);
+
+		if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16 && size <= 64) {
+			uint8_t format[64];
+			if (fread(format, 1, size, file) != size) {
+				close();
+				return false;
+			}
+
+			uint16_t tag  = getLe16(format);
+			numChannels   = getLe16(format + 2);
+			sampleRate    = getLe32(format + 4);
+			bytesPerFrame = getLe16(format + 12);
+			bitsPerSample = getLe16(format + 14);
+
+			// The sub format GUID starts with the plain format tag
+			if (tag == WAVE_FORMAT_EXTENSIBLE && size >= 26) {
+				tag = getLe16(format + 24);
+			}
+
+			isFloat    = tag == WAVE_FORMAT_IEEE_FLOAT && bitsPerSample == 32;
+			haveFormat = isFloat || (tag == WAVE_FORMAT_PCM &&
+			                         (bitsPerSample == 16 || bitsPerSample == 24 || bitsPerSample == 32));
+			if (size & 1) {
+				fseek(file, 1, SEEK_CUR);
+			}
+		} else if (memcmp(chunk, "data", 4) == 0) {
+			break;
+		} else if (fseek(file, size + (size & 1), SEEK_CUR) != 0) {
+			close();
+			return false;
+		}
+	}
+
+	if (!haveFormat || numChannels <= 0 || numChannels > WAV_MAX_CHANNELS ||
+	    bytesPerFrame != numChannels * bitsPerSample / 8) {
+		close();
+		return false;
+	}
+
+	// data is the last chunk we look at, its size may be a placeholder
+	long dataStart = ftell(file);
+	fseek(file, 0, SEEK_END);
+	long fileEnd = ftell(file);
+	fseek(file, dataStart, SEEK_SET);
+
+	frames    = (uint32_t)((fileEnd - dataStart) / bytesPerFrame);
+	remaining = frames;
+	return true;
+}
+
+int WavReader::read(float *const *planes, int frames)
+{
+	if (!file) {
+		return 0;
+	}
+
+	uint8_t raw[WAV_CHUNK_FRAMES * WAV_MAX_CHANNELS * 4];
+	int     chunkFrames = (int)sizeof(raw) / bytesPerFrame;
+	int     bytes       = bitsPerSample / 8;
+	int     total       = 0;
+
+	if ((uint32_t)frames > remaining) {
+		frames = (int)remaining;
+	}
+
+	while (total < frames) {
+		int count = frames - total < chunkFrames ? frames - total : chunkFrames;
+		count     = (int)fread(raw, bytesPerFrame, count, file);
+		if (count <= 0) {
+			break;
+		}
+
+		for (int i = 0; i < count; i++) {
+			for (int channel = 0; channel < numChannels; channel++) {
+				const uint8_t *in = raw + i * bytesPerFrame + channel * bytes;
+				float          sample;
+
+				if (isFloat) {
+					uint32_t bits = getLe32(in);
+					memcpy(&sample, &bits, sizeof(sample));
+				} else if (bytes == 2) {
+					sample = (int16_t)getLe16(in) / 32768.0f;
+				} else if (bytes == 3) {
+					int32_t value = (int32_t)((uint32_t)in[0] << 8 | (uint32_t)in[1] << 16 |
+					                          (uint32_t)in[2] << 24);
+					sample        = (float)(value / 2147483648.0);
+				} else {
+					sample = (float)((int32_t)getLe32(in) / 2147483648.0);
+				}
+
+				planes[channel][total + i] = sample;
+			}
+		}
+
+		total += count;
+	}
+
+	remaining -= total;
+	return total;
+}
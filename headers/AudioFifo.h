@@ -0,0 +1,54 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef OBS_STUDIO_AUDIOFIFO_H
+#define OBS_STUDIO_AUDIOFIFO_H
+
+/*
+ * Planar ring buffer of float samples with a fixed capacity. Only allocates
+ * in setCapacity(), so it can be used from the audio thread. Not thread safe,
+ * reader and writer must be the same thread.
+ */
+class AudioFifo {
+
+	float **planes      = nullptr;
+	int     numChannels = 0;
+	int     capacity    = 0;
+	int     readPos     = 0;
+	int     count       = 0;
+
+public:
+	AudioFifo() = default;
+	~AudioFifo();
+
+	AudioFifo(const AudioFifo &) = delete;
+	AudioFifo &operator=(const AudioFifo &) = delete;
+
+	void setCapacity(int numChannels, int frames);
+	void clear();
+
+	int available() const { return count; }
+	int space() const { return capacity - count; }
+
+	// Channels with a null pointer are skipped but still advance.
+	// Both return the number of frames actually moved.
+	int write(float *const *data, int frames);
+	int writeSilence(int frames);
+	int read(float **data, int frames);
+};
+
+#endif // OBS_STUDIO_AUDIOFIFO_H
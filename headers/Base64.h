@@ -0,0 +1,49 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef OBS_STUDIO_BASE64_H
+#define OBS_STUDIO_BASE64_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Base64 for chunk_data, standard alphabet with padding. Plug-in states can
+ * be several megabytes, so both directions work straight between the plug-in
+ * buffer and the string without intermediate copies, sixteen characters at a
+ * time with SSE2.
+ *
+ * Decoding is strict: the length and the padding are checked before
+ * anything is written, and a character outside the alphabet fails the whole
+ * text. Missing padding and trailing whitespace are accepted, as they turn
+ * up in hand-edited chunk files.
+ */
+
+size_t base64EncodedLength(size_t bytes);
+
+// Writes exactly base64EncodedLength(bytes) characters, no terminator
+void base64Encode(const uint8_t *src, size_t bytes, char *dst);
+
+// Returns false if length can't be the length of a base64 text
+bool base64DecodedLength(const char *text, size_t length, size_t &bytes);
+
+// dst holds the base64DecodedLength() bytes. Returns false on a character
+// outside the alphabet, dst may be partly written then.
+bool base64Decode(const char *text, size_t length, uint8_t *dst);
+
+#endif // OBS_STUDIO_BASE64_H
@@ -0,0 +1,79 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef OBS_STUDIO_BLOCKACCUMULATOR_H
+#define OBS_STUDIO_BLOCKACCUMULATOR_H
+
+#include "AudioFifo.h"
+
+#define BLOCK_ACCUMULATOR_MAX_CHANNELS 8
+#define BLOCK_ACCUMULATOR_MAX_FRAMES 8192
+
+/*
+ * Collects the short passes OBS delivers into large fixed blocks for
+ * plug-ins that are much cheaper per sample with big blocks, such as
+ * convolution reverbs and spectral denoisers. The output FIFO starts out
+ * holding one block of silence, so however the passes line up it never runs
+ * dry, at the cost of exactly one block of latency.
+ *
+ * Usage per pass: write(), then while nextBlock() process getInputs() into
+ * getOutputs() and call finishBlock(), then read(). Everything is allocated
+ * in configure().
+ */
+class BlockAccumulator {
+
+	int       numChannels = 0;
+	int       blockSize   = 0;
+	AudioFifo inputFifo;
+	AudioFifo outputFifo;
+
+	float **blockInputs  = nullptr;
+	float **blockOutputs = nullptr;
+
+	void freeBuffers();
+
+public:
+	BlockAccumulator() = default;
+	~BlockAccumulator();
+
+	BlockAccumulator(const BlockAccumulator &) = delete;
+	BlockAccumulator &operator=(const BlockAccumulator &) = delete;
+
+	// A block size of 0, or one no larger than maxFrames, disables it
+	void configure(int blockSize, int numChannels, int maxFrames);
+	void reset();
+
+	bool isActive() const { return blockSize != 0; }
+	int  getBlockSize() const { return blockSize; }
+	// Frames written but not yet part of a processed block
+	int  getPending() const { return inputFifo.available(); }
+
+	float **getInputs() { return blockInputs; }
+	float **getOutputs() { return blockOutputs; }
+
+	// Channels with a null pointer are skipped
+	void write(float *const *in, int frames);
+	bool nextBlock();
+	void finishBlock();
+	void read(float **out, int frames);
+
+	// Delay added, in frames at the rate the blocks are processed
+	int getLatency() const { return blockSize; }
+};
+
+#endif // OBS_STUDIO_BLOCKACCUMULATOR_H
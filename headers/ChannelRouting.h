@@ -0,0 +1,92 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef OBS_STUDIO_CHANNELROUTING_H
+#define OBS_STUDIO_CHANNELROUTING_H
+
+#include <stdint.h>
+
+#define ROUTING_MAX_CHANNELS 8
+// Sidechain channels follow the source's own in the input sources
+#define ROUTING_SIDECHAIN ROUTING_MAX_CHANNELS
+#define ROUTE_DRY -1
+#define ROUTE_SILENT -2
+
+class LevelMeter;
+
+/*
+ * Channel routing between the OBS planes and the plug-in. Every plug-in
+ * input is the mean of a set of OBS channels, every OBS channel either takes
+ * one plug-in output, keeps its dry signal or is silenced.
+ *
+ * Both sides are configured from a comma separated list with one entry per
+ * channel, counted from 1. An input entry joins OBS channels with '+' ("1+2"
+ * or "1") or is '0' for silence, an output entry names a plug-in output, '-'
+ * for dry or '0' for silence. An empty list maps channel n to channel n.
+ * Sidechain channels are written as "s1", "s2" and so on; by default they
+ * feed the plug-in inputs after the source's own channels.
+ */
+class ChannelRouting {
+
+	int      numChannels        = ROUTING_MAX_CHANNELS;
+	int      numSidechain       = 0;
+	int      numInputs          = ROUTING_MAX_CHANNELS;
+	int      numSidechainInputs = 0;
+	int      numOutputs         = ROUTING_MAX_CHANNELS;
+	bool     passthrough        = true;
+	uint32_t inputSources[ROUTING_MAX_CHANNELS];
+	float    inputGains[ROUTING_MAX_CHANNELS];
+	int      outputSources[ROUTING_MAX_CHANNELS];
+
+	int  parseSource(const char *&text) const;
+	bool parseInputs(const char *spec);
+	bool parseOutputs(const char *spec);
+	void updateSummary();
+
+public:
+	ChannelRouting();
+
+	// Returns false if a list does not parse, that side is mapped straight
+	// through then
+	bool configure(const char *inputSpec, const char *outputSpec, int numChannels, int numSidechain = 0);
+
+	// Drops whatever the plug-in does not have after the arrangement was
+	// negotiated. OBS channels routed from a missing output stay dry.
+	void limit(int pluginInputs, int pluginOutputs);
+
+	// Plug-in channels used, the arrangement asked for at load time
+	int  getInputs() const { return numInputs; }
+	int  getSidechainInputs() const { return numSidechainInputs; }
+	int  getOutputs() const { return numOutputs; }
+	bool isPassthrough() const { return passthrough; }
+
+	/*
+	 * Points in[] at the plug-in inputs for a pass. channels holds the OBS
+	 * planes followed by the sidechain planes at ROUTING_SIDECHAIN. An input
+	 * fed by a single channel uses that plane as is, only inputs mixed from
+	 * several are written to mixes. Inputs without a source keep their
+	 * pointer, so the caller points them at silence first.
+	 */
+	void routeInputs(float *const *channels, float **mixes, float **in, int frames) const;
+
+	// Copies the plug-in outputs back, OBS planes are null for channels the
+	// source does not have and hold the dry signal on entry. With a meter
+	// the copies go through it, measuring the dry and the processed signal.
+	void routeOutputs(float *const *out, float *const *obs, int frames, LevelMeter *meter = nullptr) const;
+};
+
+#endif // OBS_STUDIO_CHANNELROUTING_H
@@ -0,0 +1,81 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef OBS_STUDIO_DEADLINEWORKER_H
+#define OBS_STUDIO_DEADLINEWORKER_H
+
+#include <stdint.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/*
+ * Helper thread that runs one job at a time on behalf of the audio thread.
+ * run() hands the job over and waits for it no longer than the given
+ * deadline; a job that misses it keeps running in the background and the
+ * caller must not touch anything the job uses until it has finished.
+ */
+class DeadlineWorker {
+public:
+	typedef void (*Job)(void *param);
+
+	enum Result {
+		Finished, // completed within the deadline
+		Missed,   // still running when the deadline passed
+		Busy      // an earlier job that missed its deadline is still running
+	};
+
+private:
+	Job   job   = nullptr;
+	void *param = nullptr;
+
+	std::thread             thread;
+	std::mutex              lock;
+	std::condition_variable wakeWorker;
+	std::condition_variable jobDone;
+
+	bool started  = false;
+	bool stopping = false;
+	bool pending  = false;
+	bool busy     = false;
+
+	void loop();
+
+public:
+	DeadlineWorker() = default;
+	~DeadlineWorker();
+
+	DeadlineWorker(const DeadlineWorker &) = delete;
+	DeadlineWorker &operator=(const DeadlineWorker &) = delete;
+
+	// Not thread safe, only called while the owner's process lock is held
+	void start(Job job, void *param);
+	void stop();
+	bool isStarted() const { return started; }
+
+	bool   isBusy();
+	Result run(uint64_t timeoutNs);
+
+	// Hands the job over without waiting, false while an earlier one runs.
+	// Pair with waitIdle() before touching anything the job uses.
+	bool post();
+
+	// Blocks until a job that overran has finished
+	void waitIdle();
+};
+
+#endif // OBS_STUDIO_DEADLINEWORKER_H
@@ -0,0 +1,129 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef OBS_STUDIO_EDITORTHREAD_H
+#define OBS_STUDIO_EDITORTHREAD_H
+
+#include <stdint.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "aeffectx.h"
+
+// Bounds of the shared effEditIdle interval
+#define EDITOR_IDLE_MIN_MS 16
+#define EDITOR_IDLE_MAX_MS 100
+// Idle calls may take at most this share of the editor thread's time
+#define EDITOR_IDLE_LOAD_DIVISOR 4
+
+class VSTPlugin;
+struct _XDisplay;
+
+/*
+ * Hosts the Linux plug-in editors in top-level X11 windows of their own,
+ * all served by one thread with its own X connection. Every editor call,
+ * open, idle, resize and close, is made from that thread, so however slow a
+ * plug-in GUI is, it never stalls the OBS UI.
+ *
+ * A single timer sends effEditIdle to every editor that can be seen. It
+ * slows down when the idle calls get expensive and stops altogether while
+ * all editors are minimised or covered.
+ *
+ * Plug-ins expect their dispatcher to be called from one thread at a time,
+ * so while an editor is open the UI thread's own calls into that effect,
+ * state and programs, take lockCalls() first.
+ */
+class EditorThread {
+
+	struct Editor {
+		VSTPlugin *   owner    = nullptr;
+		AEffect *     effect   = nullptr;
+		unsigned long window   = 0;
+		bool          mapped   = false;
+		bool          obscured = false;
+	};
+
+	enum RequestType { Open, Close, SetTitle, Resize };
+
+	struct Request {
+		RequestType type;
+		VSTPlugin * owner;
+		AEffect *   effect;
+		std::string title;
+		int         width;
+		int         height;
+	};
+
+	std::thread             thread;
+	std::mutex              lock;
+	std::mutex              callLock;
+	std::condition_variable done;
+	std::vector<Request>    requests;
+	std::vector<AEffect *>  openEffects;
+	uint64_t                submitted   = 0;
+	uint64_t                handled     = 0;
+	bool                    stopping    = false;
+	int                     wakePipe[2] = {-1, -1};
+
+	// Editor thread only
+	struct _XDisplay *  display = nullptr;
+	std::vector<Editor> editors;
+	unsigned long       deleteAtom   = 0;
+	uint64_t            idleInterval = EDITOR_IDLE_MIN_MS * 1000000ULL;
+
+	bool start();
+	void loop();
+	void submit(Request request, bool wait);
+	void handleRequest(const Request &request);
+	void handleEvents();
+	void idleEditors();
+	bool anyVisible() const;
+	void openEditor(const Request &request);
+	void closeEditor(size_t index, bool notify);
+	void resizeWindow(Editor &editor, int width, int height);
+	Editor *findEditor(AEffect *effect);
+
+	EditorThread() = default;
+	~EditorThread();
+
+public:
+	EditorThread(const EditorThread &) = delete;
+	EditorThread &operator=(const EditorThread &) = delete;
+
+	static EditorThread &get();
+
+	// Closes every editor left and ends the thread, on module unload
+	void stop();
+
+	// UI thread. Returns false if there is no X server to open windows on.
+	bool open(VSTPlugin *owner, AEffect *effect, const std::string &title);
+	// UI thread, returns once effEditClose was sent
+	void close(AEffect *effect);
+	void setTitle(AEffect *effect, const std::string &title);
+	bool isOpen(AEffect *effect);
+	// UI thread, held around calls into effect while its editor is open.
+	// Not to be taken from the audio thread, an editor call can take a while.
+	std::unique_lock<std::mutex> lockCalls(AEffect *effect);
+
+	// From audioMasterSizeWindow, on whatever thread the plug-in asks
+	void resize(AEffect *effect, int width, int height);
+};
+
+#endif // OBS_STUDIO_EDITORTHREAD_H
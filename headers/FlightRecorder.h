@@ -0,0 +1,126 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef OBS_STUDIO_FLIGHTRECORDER_H
+#define OBS_STUDIO_FLIGHTRECORDER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <util/threading.h>
+#include "aeffectx.h"
+
+#define FLIGHT_RECORDER_MAX_SECONDS 60
+#define FLIGHT_RECORDER_MAX_CHANNELS 8
+#define FLIGHT_RECORDER_PASS_FRAMES 256
+#define FLIGHT_RECORDER_MAX_PARAMS 128
+#define FLIGHT_RECORDER_SNAPSHOT_PASSES 16
+#define FLIGHT_RECORDER_POST_TRIGGER_MS 250
+#define FLIGHT_RECORDER_AUTO_INTERVAL_NS 10000000000ULL
+
+/*
+ * Keeps the last few seconds of what a plug-in got and what it returned,
+ * so a glitch can be looked at after the fact. The audio thread copies
+ * every pass into preallocated rings, the dump runs on a helper thread
+ * that briefly freezes the rings and writes a WAV file (inputs followed by
+ * outputs) and a JSON file with per pass timing and parameter snapshots
+ * into the module's config directory.
+ *
+ * Memory is fixed by configure():
+ *   seconds * sampleRate * channels * 2 * 4 bytes for the audio, e.g.
+ *   ~7.3 MB for 10 s of 48 kHz stereo, plus 40 bytes per
+ *   FLIGHT_RECORDER_PASS_FRAMES frames of pass information and
+ *   FLIGHT_RECORDER_MAX_PARAMS * 4 bytes per parameter snapshot, taken
+ *   every FLIGHT_RECORDER_SNAPSHOT_PASSES passes.
+ */
+class FlightRecorder {
+public:
+	enum Reason { Manual, InvalidOutput, DeadlineMiss };
+
+	struct PassInfo {
+		uint64_t timestamp;
+		uint64_t position;
+		uint64_t processTime;
+		uint32_t frames;
+		uint32_t invalid;
+		bool     missed;
+	};
+
+private:
+	int      seconds          = 0;
+	int      numChannels      = 0;
+	uint32_t sampleRate       = 0;
+	int      capacity         = 0;
+	int      passCapacity     = 0;
+	int      snapshotCapacity = 0;
+
+	float **  inputRing      = nullptr;
+	float **  outputRing     = nullptr;
+	PassInfo *passes         = nullptr;
+	float *   snapshots      = nullptr;
+	uint64_t *snapshotPass   = nullptr;
+	int *     snapshotParams = nullptr;
+
+	// Advanced by the audio thread, read by the dump thread while frozen
+	uint64_t written          = 0;
+	uint64_t passesWritten    = 0;
+	uint64_t snapshotsWritten = 0;
+
+	std::atomic<bool> writing{false};
+	std::atomic<bool> frozen{false};
+
+	std::thread           thread;
+	os_sem_t *            wake = nullptr;
+	std::atomic<bool>     stopping{false};
+	std::atomic<int>      pendingReason{-1};
+	std::atomic<uint64_t> lastAutoDump{0};
+	std::atomic<uint64_t> dumps{0};
+
+	std::mutex  labelLock;
+	std::string label;
+
+	void stop();
+	void freeBuffers();
+	void loop();
+	void dump(Reason reason);
+	void writeJson(FILE *file, Reason reason, const std::string &wavName, uint64_t start, uint64_t end);
+
+public:
+	FlightRecorder() = default;
+	~FlightRecorder();
+
+	FlightRecorder(const FlightRecorder &) = delete;
+	FlightRecorder &operator=(const FlightRecorder &) = delete;
+
+	// Never from the audio thread. 0 seconds stops recording and frees all.
+	void configure(int seconds, int numChannels, uint32_t sampleRate);
+	bool isEnabled() const { return capacity > 0; }
+	void setLabel(const char *label);
+
+	// Audio thread only. A null effect skips the parameter snapshot.
+	void record(float *const *in, float *const *out, const PassInfo &info, AEffect *effect);
+
+	// Any thread. Automatic dumps are limited to one every ten seconds.
+	void requestDump(Reason reason);
+
+	size_t   getMemoryUsage() const;
+	uint64_t getDumps() const { return dumps; }
+};
+
+#endif // OBS_STUDIO_FLIGHTRECORDER_H
@@ -0,0 +1,102 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef OBS_STUDIO_LEVELMETER_H
+#define OBS_STUDIO_LEVELMETER_H
+
+#include <stdint.h>
+#include <atomic>
+
+#define LEVEL_METER_MAX_CHANNELS 8
+// Loudness blocks of 100 ms, 30 of them make up the short-term window
+#define LEVEL_METER_BLOCKS 30
+#define LEVEL_METER_RMS_BLOCKS 3
+
+/*
+ * Input and output levels of the filter, measured while process() copies
+ * the plug-in outputs back. At that point the OBS planes still hold the dry
+ * signal, so a single pass reads both, writes the output and keeps peak,
+ * RMS and K-weighted (BS.1770) power for each. Every 100 ms the window sums
+ * are published through atomics, where the UI can read them at any time
+ * without touching the audio thread.
+ */
+class LevelMeter {
+
+	enum { Input, Output, Signals };
+
+	struct Biquad {
+		double b0, b1, b2, a1, a2;
+	};
+
+	struct Block {
+		float    peak[Signals];
+		double   squares[Signals];
+		double   loudness[Signals];
+		uint64_t samples[Signals];
+		uint64_t frames;
+	};
+
+	int      numChannels = 0;
+	uint32_t blockLength = 0;
+	float    weights[LEVEL_METER_MAX_CHANNELS];
+	Biquad   shelf;
+	Biquad   highPass;
+
+	// K-weighting state per channel and signal, two per stage
+	double filterState[LEVEL_METER_MAX_CHANNELS][Signals][4];
+
+	Block current;
+	Block blocks[LEVEL_METER_BLOCKS];
+	int   blockPos = 0;
+
+	std::atomic<float> peak[Signals];
+	std::atomic<float> rms[Signals];
+	std::atomic<float> loudness[Signals];
+
+	static double weightedSquare(double x, const Biquad &shelf, const Biquad &highPass, double *z);
+	void          publish();
+
+public:
+	struct Levels {
+		float peak;     // dBFS over the short-term window
+		float rms;      // dBFS over 300 ms
+		float loudness; // LUFS short-term, 3 s
+	};
+
+	LevelMeter();
+
+	LevelMeter(const LevelMeter &) = delete;
+	LevelMeter &operator=(const LevelMeter &) = delete;
+
+	void configure(uint32_t sampleRate, int numChannels);
+	void reset();
+
+	/*
+	 * Copies src over dst, which holds the dry signal of that channel on
+	 * entry, and measures both. src may be dst for a channel that stays dry,
+	 * or null for one that is silenced. Audio thread only.
+	 */
+	void copy(int channel, float *dst, const float *src, int frames);
+	// Once per pass, after all channels were copied
+	void advance(int frames);
+
+	Levels getInput() const;
+	Levels getOutput() const;
+};
+
+#endif // OBS_STUDIO_LEVELMETER_H
@@ -0,0 +1,53 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef OBS_STUDIO_LINKEDINSTANCES_H
+#define OBS_STUDIO_LINKEDINSTANCES_H
+
+#include <string>
+#include <obs-module.h>
+
+class VSTPlugin;
+
+/*
+ * Filters in linked mode with the same plug-in path and link ID share one
+ * VSTPlugin, and with it the effect, its state and its editor. The shared
+ * instance runs while at least one of its filters is enabled on an active
+ * source and processes the audio of the first of them only, its liveFilter;
+ * every other filter passes its audio through. The processing options come
+ * from the owning filter, the instance's source context. Called from the UI
+ * thread and OBS signal handlers, never from the audio thread.
+ */
+
+// Returns the instance for path and linkId, created is set if filter is the
+// first to use it. The instance belongs to filter until it is released.
+VSTPlugin *acquireLinkedInstance(const std::string &path,
+                                 const std::string &linkId,
+                                 obs_source_t *     filter,
+                                 bool &             created);
+
+// Drops filter's reference and deletes the instance with the last one.
+// Returns the filter that owns the instance now if that changed.
+obs_source_t *releaseLinkedInstance(VSTPlugin *plugin, obs_source_t *filter);
+
+// Counts filter in or out of the ones the instance has to run for
+void setLinkedInstanceRunning(VSTPlugin *plugin, obs_source_t *filter, bool running);
+
+// One line for filter's statistics, says whose audio the instance processes
+std::string linkedInstanceStatus(VSTPlugin *plugin, obs_source_t *filter);
+
+#endif // OBS_STUDIO_LINKEDINSTANCES_H
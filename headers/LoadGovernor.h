@@ -0,0 +1,78 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef OBS_STUDIO_LOADGOVERNOR_H
+#define OBS_STUDIO_LOADGOVERNOR_H
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+#include <obs-module.h>
+
+// Load is looked at over windows of this length
+#define GOVERNOR_WINDOW_MS 250
+// Time after the last change before a bypassed filter is tried again
+#define GOVERNOR_HOLD_MS 3000
+// A filter comes back only if the load then stays below this share of the budget
+#define GOVERNOR_RESTORE_MARGIN 80
+#define GOVERNOR_MAX_PRIORITY 5
+// Length of the crossfade into and out of bypass, packets longer than the
+// capacity switch without one
+#define GOVERNOR_FADE_FRAMES 480
+#define GOVERNOR_FADE_CAPACITY 4096
+
+/*
+ * Module-wide load shedding. Every VST filter reports the time its audio
+ * callback took; whenever a window is complete, the thread that completes it
+ * adds everything up. While all VST filters together use more than the
+ * budget, one more filter is bypassed per window, lowest priority first and
+ * the more expensive one first among equals. Once the load has stayed low
+ * long enough, bypassed filters come back one at a time in reverse order,
+ * each only when its last known cost fits into the budget with some room.
+ *
+ * The budget is what OBS_VST_LOAD_BUDGET is set to, in percent of real
+ * time; unset or 0 leaves shedding off. Filters with priority 0 are never
+ * bypassed. Bypassed filters still account zero time, so the window keeps
+ * moving when every filter that reported time has been shed.
+ */
+struct GovernedFilter {
+	obs_source_t *        context = nullptr;
+	std::atomic<int>      priority{0};
+	std::atomic<bool>     shed{false};
+	std::atomic<uint64_t> time{0};
+	std::atomic<uint64_t> sheds{0};
+
+	// Per mille of real time in the last window, and when it was bypassed.
+	// Only touched while the governor evaluates.
+	uint64_t load     = 0;
+	uint64_t shedLoad = 0;
+};
+
+void governorInit();
+
+// UI thread, from filter create and destroy
+void governorAdd(GovernedFilter *filter);
+void governorRemove(GovernedFilter *filter);
+
+// From the audio callback, with the time spent processing. Never blocks.
+void governorAccount(GovernedFilter *filter, uint64_t start, uint64_t end);
+
+// Lines for the statistics of filter
+std::string governorStatus(GovernedFilter *filter);
+
+#endif // OBS_STUDIO_LOADGOVERNOR_H
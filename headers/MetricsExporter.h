@@ -0,0 +1,86 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef OBS_STUDIO_METRICSEXPORTER_H
+#define OBS_STUDIO_METRICSEXPORTER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <obs-module.h>
+
+#define METRICS_INTERVAL_MS 5000
+#define METRICS_BUCKETS 16
+// Upper bound of the first bucket, every further one doubles it
+#define METRICS_FIRST_BUCKET_US 16
+
+class VSTPlugin;
+
+/*
+ * Block times in power of two buckets from 16 us to 262 ms and above, the
+ * layout of a Prometheus histogram. record() only adds to relaxed atomics,
+ * so it is safe on the audio thread.
+ */
+class TimeHistogram {
+	std::atomic<uint64_t> buckets[METRICS_BUCKETS];
+	std::atomic<uint64_t> sum{0};
+
+public:
+	TimeHistogram()
+	{
+		for (int bucket = 0; bucket < METRICS_BUCKETS; bucket++) {
+			buckets[bucket] = 0;
+		}
+	}
+
+	void record(uint64_t nanoseconds)
+	{
+		uint64_t microseconds = nanoseconds / 1000;
+		int      bucket       = 0;
+		while (bucket < METRICS_BUCKETS - 1 && microseconds >= (uint64_t)METRICS_FIRST_BUCKET_US << bucket) {
+			bucket++;
+		}
+		buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+		sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+	}
+
+	// Counts per bucket, not cumulative, and the total time in ns
+	uint64_t getSum() const { return sum.load(std::memory_order_relaxed); }
+	void     getCounts(uint64_t *counts) const
+	{
+		for (int bucket = 0; bucket < METRICS_BUCKETS; bucket++) {
+			counts[bucket] = buckets[bucket].load(std::memory_order_relaxed);
+		}
+	}
+};
+
+/*
+ * Metrics snapshot of every VST filter. Set OBS_VST_METRICS to a file path
+ * before starting OBS and the module rewrites that file every five seconds
+ * in the Prometheus text format, for node_exporter's textfile collector or
+ * any agent that scrapes files. The file is replaced by a rename, so a
+ * reader never sees half of it.
+ *
+ * Filters register the instance they run while attached. The snapshot is
+ * taken on the UI thread, which is where instances are loaded and unloaded.
+ */
+void metricsInit();
+void metricsStop();
+void metricsAdd(obs_source_t *filter, VSTPlugin *plugin);
+void metricsRemove(obs_source_t *filter);
+
+#endif // OBS_STUDIO_METRICSEXPORTER_H
@@ -0,0 +1,84 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef OBS_STUDIO_MIDIEVENTQUEUE_H
+#define OBS_STUDIO_MIDIEVENTQUEUE_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include "aeffectx.h"
+
+#define MIDI_QUEUE_CAPACITY 256
+#define MIDI_EVENTS_PER_PASS 128
+
+/*
+ * Carries MIDI messages from hotkeys (or any other non audio thread) to the
+ * plug-in. Producers serialize on a mutex, the audio thread only reads the
+ * ring indices, so it never waits. Everything is preallocated: collect()
+ * fills a fixed pool of VstMidiEvents and a VstEvents block pointing at it.
+ */
+class MidiEventQueue {
+
+	struct Message {
+		uint64_t timestamp;
+		char     data[3];
+	};
+
+	Message               ring[MIDI_QUEUE_CAPACITY];
+	std::atomic<uint32_t> head{0};
+	std::atomic<uint32_t> tail{0};
+	std::mutex            producerLock;
+
+	// Same layout as VstEvents, with room for a whole pass worth of events
+	struct EventBlock {
+		int       numEvents;
+		void *    reserved;
+		VstEvent *events[MIDI_EVENTS_PER_PASS];
+	};
+
+	VstMidiEvent pool[MIDI_EVENTS_PER_PASS];
+	EventBlock   block;
+
+	std::atomic<uint64_t> delivered{0};
+	std::atomic<uint64_t> dropped{0};
+
+public:
+	MidiEventQueue();
+
+	MidiEventQueue(const MidiEventQueue &) = delete;
+	MidiEventQueue &operator=(const MidiEventQueue &) = delete;
+
+	// Never from the audio thread. Returns false if the queue is full. A
+	// timestamp of 0 is due in the next pass and plays at its first frame.
+	bool push(uint64_t timestamp, uint8_t status, uint8_t data1, uint8_t data2);
+
+	/*
+	 * Audio thread only. Turns every message due before end into events with
+	 * offsets relative to start, spread over frames plug-in frames. Returns
+	 * nullptr when nothing is due. Stays valid until the next call.
+	 */
+	VstEvents *collect(uint64_t start, uint64_t end, int frames);
+
+	// Consumer side, only while the audio thread is not processing
+	void clear();
+
+	uint64_t getDelivered() const { return delivered; }
+	uint64_t getDropped() const { return dropped; }
+};
+
+#endif // OBS_STUDIO_MIDIEVENTQUEUE_H
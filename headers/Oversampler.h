@@ -0,0 +1,95 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef OBS_STUDIO_OVERSAMPLER_H
+#define OBS_STUDIO_OVERSAMPLER_H
+
+#define OVERSAMPLER_MAX_FACTOR 4
+#define HALFBAND_TAPS 32
+
+/*
+ * One 2x stage of a polyphase half-band FIR (63 taps, Kaiser window).
+ * Every other coefficient of a half-band filter is zero, so each output
+ * sample only needs a 32 tap dot product on one polyphase branch, while the
+ * other branch is a plain delay through the 0.5 centre tap.
+ */
+class HalfBandFilter {
+
+	float history[2 * HALFBAND_TAPS];
+	float delay[2 * HALFBAND_TAPS];
+	int   historyPos = 0;
+	int   delayPos   = 0;
+
+	void push(float *buffer, int &pos, float sample);
+
+public:
+	HalfBandFilter();
+	void reset();
+
+	// in: frames samples, out: frames * 2 samples
+	void upsample(const float *in, float *out, int frames);
+	// in: frames * 2 samples, out: frames samples
+	void downsample(const float *in, float *out, int frames);
+
+	// Group delay of one up or down pass, in samples at the higher rate.
+	static int latency() { return HALFBAND_TAPS - 1; }
+};
+
+/*
+ * Runs a block through 1, 2 or 4 times oversampling by cascading 2x
+ * half-band stages. All buffers are sized for BLOCK_SIZE frames when the
+ * factor is set, so upsample()/downsample() never allocate.
+ */
+class Oversampler {
+
+	int factor      = 1;
+	int numChannels = 0;
+	int blockSize   = 0;
+
+	HalfBandFilter *upStages[OVERSAMPLER_MAX_FACTOR / 2] = {};
+	HalfBandFilter *downStages[OVERSAMPLER_MAX_FACTOR / 2] = {};
+
+	float **intermediate = nullptr;
+	float **highInputs   = nullptr;
+	float **highOutputs  = nullptr;
+
+	void freeBuffers();
+	int  numStages() const { return factor == 4 ? 2 : factor == 2 ? 1 : 0; }
+
+public:
+	Oversampler() = default;
+	~Oversampler();
+
+	Oversampler(const Oversampler &) = delete;
+	Oversampler &operator=(const Oversampler &) = delete;
+
+	void setFactor(int factor, int numChannels, int blockSize);
+	int  getFactor() const { return factor; }
+	void reset();
+
+	// Buffers at the oversampled rate that are handed to the plug-in.
+	float **getHighInputs() { return highInputs; }
+	float **getHighOutputs() { return highOutputs; }
+
+	void upsample(int channel, const float *in, int frames);
+	void downsample(int channel, float *out, int frames);
+
+	// Round trip delay in frames at the base rate.
+	double getLatency() const;
+};
+
+#endif // OBS_STUDIO_OVERSAMPLER_H
@@ -0,0 +1,94 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef OBS_STUDIO_PARAMETERSMOOTHER_H
+#define OBS_STUDIO_PARAMETERSMOOTHER_H
+
+#include <stdint.h>
+#include <atomic>
+#include "aeffectx.h"
+
+// Frames per sub-block while any parameter is ramping
+#define SMOOTHING_BLOCK_SIZE 32
+
+/*
+ * Moves parameters to new values in small linear steps instead of one jump.
+ * Targets are posted from any thread with setTarget(); the audio thread
+ * picks them up in update() and calls advance() before every sub-block.
+ * While nothing ramps isRamping() is false and the host runs whole passes.
+ */
+class ParameterSmoother {
+
+	int numParams  = 0;
+	int rampFrames = 0;
+
+	// Audio thread state
+	float *current    = nullptr;
+	float *target     = nullptr;
+	float *increment  = nullptr;
+	int *  remaining  = nullptr;
+	int *  ramping    = nullptr;
+	bool * canRamp    = nullptr;
+	int    numRamping = 0;
+
+	// Posted targets
+	std::atomic<float> *  requested = nullptr;
+	std::atomic<bool> *   dirty     = nullptr;
+	std::atomic<bool>     pending{false};
+	std::atomic<uint64_t> ramps{0};
+
+	// Further instances that get every value handed to the effect as well
+	AEffect *const *followers    = nullptr;
+	int             numFollowers = 0;
+
+	void freeBuffers();
+	void setParameter(AEffect *effect, int index, float value);
+
+public:
+	ParameterSmoother() = default;
+	~ParameterSmoother();
+
+	ParameterSmoother(const ParameterSmoother &) = delete;
+	ParameterSmoother &operator=(const ParameterSmoother &) = delete;
+
+	// Queries the ramp flags of every parameter, never from the audio thread
+	void configure(AEffect *effect, int rampFrames);
+	void setRampFrames(int frames) { rampFrames = frames; }
+	// Only while the audio thread is kept out
+	void setFollowers(AEffect *const *effects, int count)
+	{
+		followers    = effects;
+		numFollowers = count;
+	}
+	void reset();
+
+	bool isEnabled() const { return rampFrames > 0; }
+	bool isRampable(int index) const { return index >= 0 && index < numParams && canRamp[index]; }
+
+	// Any thread. Rampable parameters only, others should be set directly.
+	void setTarget(int index, float value);
+
+	// Audio thread: starts ramps for newly posted targets
+	void update(AEffect *effect);
+	// Audio thread: moves all ramps on by frames and hands the values over
+	void advance(AEffect *effect, int frames);
+	bool isRamping() const { return numRamping > 0; }
+
+	uint64_t getRamps() const { return ramps; }
+};
+
+#endif // OBS_STUDIO_PARAMETERSMOOTHER_H
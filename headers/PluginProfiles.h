@@ -0,0 +1,53 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef OBS_STUDIO_PLUGINPROFILES_H
+#define OBS_STUDIO_PLUGINPROFILES_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define PROFILE_TIMEOUT_MS 60000
+
+/*
+ * CPU cost of the installed plug-ins, measured ahead of time so the plug-in
+ * list can show it. Each plug-in is profiled in a process of its own by
+ * obs-vst-render --profile, found through OBS_VST_PROFILER, so a plug-in
+ * that crashes or hangs only takes that process down. Results are kept in
+ * plugin-profiles.json in the module's config directory, per file and
+ * sample rate, and measured again when the file changes.
+ */
+
+struct PluginProfile {
+	double usPerBlock = 0.0;
+	double latencyMs  = 0.0;
+};
+
+void profilesLoad();
+void profilesStop();
+bool profilerAvailable();
+bool profilingRunning();
+
+// False if the plug-in was not profiled at this rate, or failed to load
+bool profileLookup(const std::string &path, uint32_t sampleRate, PluginProfile &profile);
+
+// Profiles every path without a current entry on a background thread
+void profileAll(const std::vector<std::string> &paths, uint32_t sampleRate, int channels);
+
+#endif // OBS_STUDIO_PLUGINPROFILES_H
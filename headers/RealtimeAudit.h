@@ -0,0 +1,73 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef OBS_STUDIO_REALTIMEAUDIT_H
+#define OBS_STUDIO_REALTIMEAUDIT_H
+
+/*
+ * Real-time safety audit, only built with -DVST_RT_AUDIT=ON on Linux.
+ *
+ * The checks themselves live in a separate shim (linux/RealtimeAuditShim.cpp)
+ * that is loaded with LD_PRELOAD and wraps malloc/free, mutex and condition
+ * waits, sleeps and blocking I/O. The filter only tells it who owns the
+ * current thread: the host while inside vst_filter_audio, the plug-in while
+ * inside processReplacing. Without the shim, or in regular builds, all of
+ * this compiles down to nothing.
+ */
+
+#define HOST_AUDIT_OWNER "obs-vst host"
+
+#ifdef VST_RT_AUDIT
+void        realtimeAuditInit();
+const char *realtimeAuditSwapOwner(const char *owner);
+#else
+static inline void realtimeAuditInit() {}
+static inline const char *realtimeAuditSwapOwner(const char *owner)
+{
+	(void)owner;
+	return nullptr;
+}
+#endif
+
+/*
+ * Attributes everything the current thread does to owner while in scope.
+ * A null owner leaves the attribution untouched.
+ */
+class RealtimeAuditScope {
+	const char *previous = nullptr;
+	bool        active;
+
+public:
+	explicit RealtimeAuditScope(const char *owner) : active(owner != nullptr)
+	{
+		if (active) {
+			previous = realtimeAuditSwapOwner(owner);
+		}
+	}
+
+	~RealtimeAuditScope()
+	{
+		if (active) {
+			realtimeAuditSwapOwner(previous);
+		}
+	}
+
+	RealtimeAuditScope(const RealtimeAuditScope &) = delete;
+	RealtimeAuditScope &operator=(const RealtimeAuditScope &) = delete;
+};
+
+#endif // OBS_STUDIO_REALTIMEAUDIT_H
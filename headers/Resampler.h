@@ -0,0 +1,120 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef OBS_STUDIO_RESAMPLER_H
+#define OBS_STUDIO_RESAMPLER_H
+
+#include <stdint.h>
+#include "AudioFifo.h"
+
+#define RESAMPLER_TAPS 64
+#define RATE_CONVERTER_PRIME_FRAMES 4
+#define RATE_CONVERTER_MAX_CHANNELS 8
+
+/*
+ * Streaming sample rate converter for a fixed rational ratio. The windowed
+ * sinc prototype is split into one 64 tap polyphase row per output phase,
+ * so every output sample is a single SIMD dot product against the input
+ * history. The tables are built in configure(), process() never allocates.
+ */
+class Resampler {
+
+	int      numChannels = 0;
+	uint32_t upFactor    = 1;
+	uint32_t downFactor  = 1;
+	uint32_t phase       = 0;
+	int      historyPos  = 0;
+
+	float * bank    = nullptr;
+	float **history = nullptr;
+
+	void freeBuffers();
+
+public:
+	Resampler() = default;
+	~Resampler();
+
+	Resampler(const Resampler &) = delete;
+	Resampler &operator=(const Resampler &) = delete;
+
+	void configure(uint32_t inRate, uint32_t outRate, int numChannels);
+	void reset();
+
+	// Channels with a null input are skipped. All channels share the same
+	// phase, so the returned number of output frames is the same for each.
+	int process(float *const *in, float **out, int frames);
+
+	// Upper bound of output frames for the given number of input frames
+	int maxOutputFrames(int frames) const;
+
+	// Group delay in input frames
+	static double getLatency() { return RESAMPLER_TAPS / 2.0; }
+};
+
+/*
+ * Runs the plug-in at a fixed internal rate. Every OBS pass is converted to
+ * the internal rate, processed, converted back and queued in a small FIFO
+ * that is primed with a few frames of silence. The number of frames produced
+ * per pass jitters by a frame or two, the FIFO absorbs that so exactly as
+ * many frames come out as went in.
+ */
+class RateConverter {
+
+	uint32_t hostRate          = 0;
+	uint32_t internalRate      = 0;
+	int      numChannels       = 0;
+	int      maxInternalFrames = 0;
+
+	Resampler toInternal;
+	Resampler toHost;
+	AudioFifo outputFifo;
+
+	float **internalInputs  = nullptr;
+	float **internalOutputs = nullptr;
+	float **converted       = nullptr;
+	bool *  channelActive   = nullptr;
+
+	void freeBuffers();
+
+public:
+	RateConverter() = default;
+	~RateConverter();
+
+	RateConverter(const RateConverter &) = delete;
+	RateConverter &operator=(const RateConverter &) = delete;
+
+	// An internal rate of 0 or equal to the host rate disables conversion
+	void configure(uint32_t hostRate, uint32_t internalRate, int numChannels, int maxHostFrames);
+	void reset();
+
+	bool     isActive() const { return internalRate != 0; }
+	uint32_t getInternalRate() const { return internalRate; }
+	int      getMaxInternalFrames() const { return maxInternalFrames; }
+
+	float **getInternalInputs() { return internalInputs; }
+	float **getInternalOutputs() { return internalOutputs; }
+
+	// Converts a host pass into getInternalInputs(), returns internal frames
+	int convertInput(float *const *in, int frames);
+	// Converts getInternalOutputs() back and fills exactly frames host frames
+	void convertOutput(float **out, int internalFrames, int frames);
+
+	// Delay added by both conversions and the FIFO, in host frames
+	double getLatency() const;
+};
+
+#endif // OBS_STUDIO_RESAMPLER_H
@@ -0,0 +1,144 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef OBS_STUDIO_SIDECHAIN_H
+#define OBS_STUDIO_SIDECHAIN_H
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <obs-module.h>
+
+// A bit over a second at 48 kHz, must be a power of two
+#define SIDECHAIN_RING_FRAMES 65536
+// Timing differences below this are treated as jitter, not as a jump
+#define SIDECHAIN_RESYNC_MS 20
+// How often a missing sidechain source is looked up again
+#define SIDECHAIN_LOOKUP_INTERVAL_NS 3000000000ULL
+
+/*
+ * Single producer, single consumer ring of planar audio with timestamps.
+ * The producer is the capture callback of the key source, the consumer the
+ * audio thread of the filter; neither ever waits for the other.
+ *
+ * Ring positions are mapped to timestamps through an anchor the producer
+ * moves whenever the key source's timestamps jump. It is published under a
+ * sequence count, the reader simply retries in the unlikely case it raced
+ * an update.
+ */
+class SidechainRing {
+
+	float ** planes      = nullptr;
+	float ** scratch     = nullptr;
+	float *  silence     = nullptr;
+	int      numChannels = 0;
+	int      maxFrames   = 0;
+	uint32_t sampleRate  = 0;
+
+	std::atomic<uint64_t> writePos{0};
+	std::atomic<uint32_t> anchorSeq{0};
+	std::atomic<uint64_t> anchorPos{0};
+	std::atomic<uint64_t> anchorTime{0};
+	std::atomic<bool>     resync{true};
+
+	// Consumer side
+	uint64_t readPos        = 0;
+	uint64_t lastAnchorPos  = 0;
+	uint64_t lastAnchorTime = 0;
+
+	std::atomic<uint64_t> jumps{0};
+	std::atomic<uint64_t> lateReads{0};
+	std::atomic<uint64_t> silentReads{0};
+
+	void freeBuffers();
+
+public:
+	SidechainRing() = default;
+	~SidechainRing();
+
+	SidechainRing(const SidechainRing &) = delete;
+	SidechainRing &operator=(const SidechainRing &) = delete;
+
+	// Neither producer nor consumer may be running
+	void configure(int numChannels, uint32_t sampleRate, int maxFrames);
+	bool isConfigured() const { return planes != nullptr; }
+
+	// Producer. Null planes and muted packets are written as silence.
+	void write(uint8_t *const *data, int frames, uint64_t timestamp, bool muted);
+	// Any thread, the next write starts a new anchor
+	void restart() { resync = true; }
+
+	/*
+	 * Consumer. Points planes at the frames that line up with timestamp,
+	 * continuing seamlessly from the previous read while the timing stays
+	 * within SIDECHAIN_RESYNC_MS. The pointers go straight into the ring and
+	 * stay valid until the next read, only a read across the end of the ring
+	 * is copied. A key that is late is read from the newest frames there are.
+	 */
+	void read(float **planes, int frames, uint64_t timestamp);
+
+	uint64_t getJumps() const { return jumps; }
+	uint64_t getLateReads() const { return lateReads; }
+	uint64_t getSilentReads() const { return silentReads; }
+};
+
+/*
+ * Feeds the audio of another OBS source into a SidechainRing through an
+ * audio capture callback. The source is looked up by name and only held
+ * through a weak reference, so it can be removed and added again.
+ */
+class Sidechain {
+
+	SidechainRing ring;
+
+	// Serializes setSource() and update(), never taken on the audio thread
+	std::mutex         lock;
+	std::string        sourceName;
+	obs_weak_source_t *weakSource = nullptr;
+	uint64_t           lastLookup = 0;
+	std::atomic<bool>  connected{false};
+
+	void attach(obs_source_t *source);
+	void detach();
+
+	static void capture_static(void *param, obs_source_t *source, const struct audio_data *audio, bool muted);
+
+public:
+	Sidechain() = default;
+	~Sidechain();
+
+	Sidechain(const Sidechain &) = delete;
+	Sidechain &operator=(const Sidechain &) = delete;
+
+	// Not while the consumer reads, an empty name disconnects
+	void setSource(const char *name, int numChannels, uint32_t sampleRate, int maxFrames);
+	// Picks the source up once it exists, or again after it was removed
+	void update();
+
+	bool isConnected() const { return connected; }
+
+	// Audio thread, see SidechainRing::read()
+	void read(float **planes, int frames, uint64_t timestamp) { ring.read(planes, frames, timestamp); }
+
+	// For the statistics
+	std::string         getSourceName();
+	const SidechainRing &getRing() const { return ring; }
+};
+
+#endif // OBS_STUDIO_SIDECHAIN_H
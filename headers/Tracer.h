@@ -0,0 +1,71 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef OBS_STUDIO_TRACER_H
+#define OBS_STUDIO_TRACER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <util/platform.h>
+
+#define TRACE_MAX_THREADS 16
+#define TRACE_EVENTS_PER_THREAD 16384
+#define TRACE_DETAIL_LENGTH 36
+
+/*
+ * Opt-in span tracer. Set OBS_VST_TRACE to a file path before starting OBS
+ * and the spans recorded by TraceScope are written there as Chrome trace
+ * event JSON (chrome://tracing, Perfetto) when the module unloads.
+ *
+ * Every thread claims one of TRACE_MAX_THREADS fixed buffers on its first
+ * span and is the only writer to it, so recording never locks or
+ * allocates. Each buffer is a ring holding the newest 16384 spans of its
+ * thread and is handed back when the thread exits. Enabled, the buffers
+ * take 16 * 16384 * 64 bytes = 16 MB; spans from threads that find every
+ * buffer taken are counted and dropped.
+ */
+
+extern std::atomic<bool> traceEnabled;
+
+void traceInit();
+void traceWrite();
+void traceEvent(const char *name, const char *detail, uint64_t start, uint64_t end);
+
+class TraceScope {
+	const char *name;
+	const char *detail;
+	uint64_t    start;
+
+public:
+	// name must be a string literal, detail is copied
+	explicit TraceScope(const char *name, const char *detail = nullptr)
+	        : name(name), detail(detail), start(traceEnabled.load(std::memory_order_relaxed) ? os_gettime_ns() : 0)
+	{
+	}
+
+	~TraceScope()
+	{
+		if (start) {
+			traceEvent(name, detail, start, os_gettime_ns());
+		}
+	}
+
+	TraceScope(const TraceScope &) = delete;
+	TraceScope &operator=(const TraceScope &) = delete;
+};
+
+#endif // OBS_STUDIO_TRACER_H
@@ -0,0 +1,47 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef OBS_STUDIO_VSTHOST_H
+#define OBS_STUDIO_VSTHOST_H
+
+#include <stdint.h>
+#include <obs-module.h>
+
+/*
+ * What VSTPlugin asks of the host around it: the audio format it runs at
+ * and the names put in editor titles. The filter uses getObsHost(), which
+ * asks libobs; obs-vst-render and the benchmarks pass their own, so the
+ * engine runs without a started OBS.
+ */
+class VSTHost {
+public:
+	virtual ~VSTHost() {}
+
+	// Read when a VSTPlugin is created and when it is reconfigured
+	virtual uint32_t getSampleRate() = 0;
+	virtual int      getChannels() = 0;
+
+	// UI thread, for editor titles. Either may return nullptr.
+	virtual const char *getFilterName(obs_source_t *filter) = 0;
+	virtual const char *getTargetName(obs_source_t *filter) = 0;
+};
+
+// The running OBS
+VSTHost *getObsHost();
+
+#endif // OBS_STUDIO_VSTHOST_H
@@ -21,13 +21,30 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #define VST_MAX_CHANNELS 8
 #define BLOCK_SIZE 512
+#define VST_MAX_EXTRA_PAIRS (VST_MAX_CHANNELS / 2 - 1)
 
+#include <atomic>
+#include <mutex>
 #include <string>
 #include <QDirIterator>
 #include <obs-module.h>
 #include "aeffectx.h"
 #include "vst-plugin-callbacks.hpp"
+#include "BlockAccumulator.h"
+#include "ChannelRouting.h"
 #include "EditorWidget.h"
+#include "DeadlineWorker.h"
+#include "FlightRecorder.h"
+#include "LevelMeter.h"
+#include "MetricsExporter.h"
+#include "MidiEventQueue.h"
+#include "Oversampler.h"
+#include "ParameterSmoother.h"
+#include "RealtimeAudit.h"
+#include "Resampler.h"
+#include "Sidechain.h"
+#include "Tracer.h"
+#include "VSTHost.h"
 
 #ifdef __APPLE__
 #include <CoreFoundation/CoreFoundation.h>
@@ -40,21 +57,177 @@ class VSTPlugin : public QObject {
 
 	AEffect *     effect = nullptr;
 	obs_source_t *sourceContext;
+	VSTHost *     host;
 	std::string   pluginPath;
 
 	float **inputs;
 	float **outputs;
 
-	EditorWidget *editorWidget = nullptr;
-	bool          editorOpened = false;
+	// Held by process() for a whole packet; anything that reconfigures the
+	// effect takes it so the audio thread never sees a half-updated state.
+	std::mutex processLock;
+
+	uint32_t      sampleRate = 0;
+	Oversampler   oversampler;
+	RateConverter rateConverter;
+
+	std::atomic<uint64_t> resamplerTime{0};
+	std::atomic<uint64_t> resamplerBlocks{0};
+	std::atomic<uint64_t> converterTime{0};
+	std::atomic<uint64_t> converterBlocks{0};
+
+	// Large-block mode, see setBlockAccumulation()
+	BlockAccumulator accumulator;
+	int              accumulationFrames = 0;
+
+	/*
+	 * 64-bit processing, see setDoublePrecision(). Requested by the user and
+	 * used only if the plug-in supports it; the planes are converted into
+	 * doubleInputs and back from doubleOutputs around every call.
+	 */
+	bool                  doublePrecision = false;
+	bool                  processDouble   = false;
+	double **             doubleInputs    = nullptr;
+	double **             doubleOutputs   = nullptr;
+	std::atomic<uint64_t> doubleTime{0};
+	std::atomic<uint64_t> doubleBlocks{0};
+
+	// Output sanitizer counters, see handleInvalidOutput()
+	std::atomic<uint64_t> invalidSamples{0};
+	std::atomic<uint64_t> invalidPasses{0};
+	std::atomic<uint64_t> pluginResets{0};
+	int                   consecutiveFaults = 0;
+
+	/*
+	 * Deadline watchdog. With a budget set every pass runs on the worker
+	 * thread from private copies of the input, so an overrunning pass can be
+	 * abandoned and the packet is passed through dry instead.
+	 */
+	DeadlineWorker        worker;
+	float *               jobPlanes[VST_MAX_CHANNELS];
+	float **              jobInputs         = nullptr;
+	struct obs_audio_data jobAudio          = {};
+	uint                  jobFrames         = 0;
+	uint64_t              jobTimestamp      = 0;
+	int                   deadlineBudget    = 0;
+	int                   maxDeadlineMisses = 0;
+	int                   consecutiveMisses = 0;
+	bool                  watchdogTripped   = false;
+	std::atomic<uint64_t> deadlineMisses{0};
+	std::atomic<uint64_t> watchdogTrips{0};
+
+	// Only plug-ins that can receive MIDI get events delivered
+	MidiEventQueue    midiQueue;
+	std::atomic<bool> acceptsMidi{false};
+
+	// Externally set parameters are ramped, see processPass()
+	ParameterSmoother     smoother;
+	int                   smoothingTime = 0;
+	std::atomic<uint64_t> subBlocks{0};
+
+	FlightRecorder recorder;
+	uint32_t       passInvalid = 0;
+
+	// Filled while the outputs are copied back, see getStatistics()
+	LevelMeter meter;
+
+	/*
+	 * Host loop of process(), specialised per OBS channel layout and for
+	 * packets made of whole blocks. Chosen again only when the layout or the
+	 * packet size changes, see selectPacketKernel().
+	 */
+	typedef void (VSTPlugin::*PacketKernel)(struct obs_audio_data *audio);
+	PacketKernel              packetKernel = nullptr;
+	uint32_t                  packetLayout = 0;
+	uint32_t                  packetFrames = 0;
+	std::atomic<const char *> packetKernelName{"generic"};
+	std::atomic<bool>         packetFullBlocks{false};
+	std::atomic<uint64_t>     packetTime{0};
+	std::atomic<uint64_t>     effectTime{0};
+	std::atomic<uint64_t>     packetBlocks{0};
+
+	// For the metrics snapshot, stateSize is the chunk last saved or loaded
+	TimeHistogram         blockTimes;
+	std::atomic<uint64_t> overruns{0};
+	std::atomic<uint64_t> stateSize{0};
+
+	/*
+	 * Stereo pair fan-out. A stereo plug-in on a surround source gets one
+	 * more instance per further channel pair, with the state of the main one
+	 * cloned and its parameters followed. The extra pairs run on their own
+	 * workers while the audio thread processes the first pair.
+	 */
+	struct PairJob {
+		VSTPlugin *plugin    = nullptr;
+		AEffect *  effect    = nullptr;
+		float **   in        = nullptr;
+		float **   out       = nullptr;
+		double **  doubleIn  = nullptr;
+		double **  doubleOut = nullptr;
+		uint       frames    = 0;
+	};
+	vstPluginMain mainEntry   = nullptr;
+	bool          stereoPairs = false;
+	int           numPairs    = 0;
+
+	AEffect *      pairEffects[VST_MAX_EXTRA_PAIRS] = {};
+	PairJob        pairJobs[VST_MAX_EXTRA_PAIRS];
+	DeadlineWorker pairWorkers[VST_MAX_EXTRA_PAIRS];
+
+	// Editor automation runs outside processLock, it reaches the pairs
+	// through automatedPairs and destroyPairs() waits out any in flight
+	std::atomic<int> automatedPairs{0};
+	std::atomic<int> automating{0};
+
+	/*
+	 * Channel routing, see setRouting(). The plug-in is asked for as many
+	 * channels as the routing uses, routedAudio marks the plug-in channels
+	 * in use and routedMixes holds inputs mixed from several OBS channels.
+	 */
+	ChannelRouting        routing;
+	std::string           inputRouting;
+	std::string           outputRouting;
+	float **              routedMixes = nullptr;
+	struct obs_audio_data routedAudio = {};
+	VstSpeakerArrangement inputArrangement;
+	VstSpeakerArrangement outputArrangement;
+
+	// Another source's audio, fed to the plug-in as extra inputs
+	Sidechain sidechain;
+	int       sidechainChannels = 0;
+
+	// Handed out through audioMasterGetTime, updated before every pass
+	VstTimeInfo timeInfo           = {};
+	uint64_t    nextBlockTimestamp = 0;
+	// Start of the pass being processed, blocks are timed from it
+	uint64_t    passTimestamp      = 0;
+
+	EditorWidget *editorWidget   = nullptr;
+	bool          editorOpened   = false;
+	// Hosted by EditorThread instead of editorWidget, Linux only
+	bool          editorThreaded = false;
 
 	AEffect *loadEffect();
 
+	std::string getEditorTitle() const;
+
+	// The host's channels, capped to what the plug-in buffers hold
+	int getOutputChannels() const;
+
+	// Keeps UI thread calls into the effect apart from its open editor's
+	std::unique_lock<std::mutex> lockEditorCalls();
+
 	bool effectReady = false;
 
+	// The effect is only resumed (effMainsChanged 1) while the filter is
+	// enabled and its source is active, otherwise it is suspended.
+	bool filterEnabled = true;
+	bool targetActive  = true;
+	bool running       = false;
+
 	std::string sourceName;
 	std::string filterName;
-	char        effectName[64];
+	char        effectName[64] = {};
 	// Remove below... or comment out
 	char vendorString[64];
 
@@ -68,6 +241,39 @@ class VSTPlugin : public QObject {
 
 	void unloadLibrary();
 
+	uint32_t getProcessingRate();
+	float    getEffectSampleRate();
+	int      getEffectBlockSize();
+	void     getEffectChannels(int &inputChannels, int &outputChannels);
+	void     updateProcessingFormat();
+	void     setEffectFormat(AEffect *target);
+	bool     configureRouting();
+	void     applyRouting();
+	bool     negotiateArrangement();
+	void     limitRouting();
+	void     createPairs();
+	void     destroyPairs();
+	void     clonePairState();
+	void     setLinkedParameter(int index, float value);
+	void     processEffects(float **in, float **out, uint frames);
+	void     processBlocks(float **in, float **out, uint frames);
+	size_t   runEffect(float **in, float **out, struct obs_audio_data *audio, uint frames);
+	size_t   processOversampled(float **in, float **out, struct obs_audio_data *audio, uint frames);
+	size_t   processConverted(float **in, float **out, struct obs_audio_data *audio, uint frames);
+	size_t   sanitizeOutputs(float **planes, struct obs_audio_data *audio, uint frames);
+	void     handleInvalidOutput(size_t invalid);
+	void     deliverEvents(uint64_t start, uint64_t end, int effectFrames);
+	void     processPass(float **adata, struct obs_audio_data *audio, uint frames, uint64_t timestamp);
+	bool     processWatched(float **adata, struct obs_audio_data *audio, uint frames, uint64_t timestamp);
+	void     handleMissedDeadline();
+	void     recordPass(float **adata, uint frames, uint64_t timestamp, uint64_t startTime, bool processed);
+	void     selectPacketKernel(struct obs_audio_data *audio);
+	template<int Channels, bool FullBlocks> void processPacket(struct obs_audio_data *audio);
+	void     updateTimeInfo(uint64_t timestamp, uint64_t end);
+	void     suspendEffect();
+	void     resumeEffect();
+	void     updateSuspension();
+
 	static intptr_t
 	hostCallback_static(AEffect *effect, int32_t opcode, int32_t index, intptr_t value, void *ptr, float opt)
 	{
@@ -87,24 +293,76 @@ class VSTPlugin : public QObject {
 
 	intptr_t hostCallback(AEffect *effect, int32_t opcode, int32_t index, intptr_t value, void *ptr, float opt);
 
+	static void processJob_static(void *param);
+	static void pairJob_static(void *param);
+
 public:
-	VSTPlugin(obs_source_t *sourceContext);
+	VSTPlugin(obs_source_t *sourceContext, VSTHost *host = getObsHost());
 	~VSTPlugin();
 	void            loadEffectFromPath(std::string path);
 	void            unloadEffect();
 	std::string     getChunk();
-	void            setChunk(std::string data);
+	void            setChunk(const char *data, size_t length);
 	void            setProgram(const int programNumber);
 	int             getProgram();
-	void            getSourceNames();
 	obs_audio_data *process(struct obs_audio_data *audio);
 	bool            openInterfaceWhenActive = false;
 
+	std::atomic<bool> resetOnInvalidOutput{false};
+
+	std::atomic<int> midiChannel{0};
+	std::atomic<int> midiNote{60};
+	std::atomic<int> midiVelocity{100};
+
+	// The one filter whose audio a linked instance processes, see LinkedInstances
+	std::atomic<obs_source_t *> liveFilter{nullptr};
+
+	// Queues a short MIDI message for the start of the next pass, from any non audio thread
+	bool queueMidi(uint8_t status, uint8_t data1, uint8_t data2);
+
+	void          setProcessingOptions(int oversampling, uint32_t internalRate);
+	void          setDeadline(int budgetPercent, int maxMisses);
+	void          setSmoothingTime(int milliseconds);
+	void          setStereoPairs(bool enabled);
+	void          setDoublePrecision(bool enabled);
+	void          setBlockAccumulation(int frames);
+	void          setRouting(const char *inputs, const char *outputs);
+	void          setSidechain(const char *sourceName);
+	void          updateSidechain();
+	void          setFlightRecorder(int seconds);
+	void          dumpFlightRecorder();
+	void          automateParameter(int index, float value);
+	void          setEnabled(bool enabled);
+	void          setTargetActive(bool active);
+	double        getLatency();
+	std::string   getStatistics();
+	obs_source_t *getSourceContext() { return sourceContext; }
+	void          setSourceContext(obs_source_t *context);
+
 	bool isEditorOpen();
+	bool isEffectReady() const { return effect && effectReady; }
+
+	// Counters and gauges of the instance, see MetricsExporter. Times in ns.
+	struct Metrics {
+		std::string name;
+		bool        running;
+		uint64_t    processTime;
+		uint64_t    blocks;
+		uint64_t    blockTimes[METRICS_BUCKETS];
+		uint64_t    blockTimeSum;
+		uint64_t    overruns;
+		uint64_t    deadlineMisses;
+		double      latency;
+		uint64_t    stateSize;
+		uint64_t    hostMemory;
+	};
+	void getMetrics(Metrics &metrics);
 
 public slots:
 	void openEditor();
 	void closeEditor();
+	void editorClosed();
+	void updateSourceNames();
 };
 
 #endif // OBS_STUDIO_VSTPLUGIN_H
@@ -0,0 +1,85 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+#ifndef OBS_STUDIO_WAVFILE_H
+#define OBS_STUDIO_WAVFILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Minimal writer for 32 bit float WAV files. Takes planar data and
+ * interleaves it in small chunks, the sizes in the header are patched in
+ * close(). Not meant for the audio thread.
+ */
+class WavWriter {
+
+	FILE *   file        = nullptr;
+	int      numChannels = 0;
+	uint32_t dataBytes   = 0;
+
+public:
+	WavWriter() = default;
+	~WavWriter();
+
+	WavWriter(const WavWriter &) = delete;
+	WavWriter &operator=(const WavWriter &) = delete;
+
+	bool open(const char *path, int numChannels, uint32_t sampleRate);
+	bool isOpen() const { return file != nullptr; }
+
+	// One pointer per channel; a null channel is written as silence
+	bool write(const float *const *planes, int frames);
+	bool close();
+};
+
+/*
+ * Reader for 16, 24 and 32 bit integer and 32 bit float WAV files, including
+ * WAVE_FORMAT_EXTENSIBLE ones. Deinterleaves into planar float data in
+ * small chunks.
+ */
+class WavReader {
+
+	FILE *   file          = nullptr;
+	int      numChannels   = 0;
+	uint32_t sampleRate    = 0;
+	int      bytesPerFrame = 0;
+	int      bitsPerSample = 0;
+	bool     isFloat       = false;
+	uint32_t frames        = 0;
+	uint32_t remaining     = 0;
+
+public:
+	WavReader() = default;
+	~WavReader();
+
+	WavReader(const WavReader &) = delete;
+	WavReader &operator=(const WavReader &) = delete;
+
+	bool open(const char *path);
+	bool isOpen() const { return file != nullptr; }
+	void close();
+
+	int      getChannels() const { return numChannels; }
+	uint32_t getSampleRate() const { return sampleRate; }
+	uint32_t getFrames() const { return frames; }
+
+	// One pointer per channel, returns the number of frames read
+	int read(float *const *planes, int frames);
+};
+
+#endif // OBS_STUDIO_WAVFILE_H
@@ -0,0 +1,261 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+#pragma once
+
+#include <float.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <util/sse-intrin.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/*
+ * Small vector kernels shared by the audio path. Everything in here works on
+ * unaligned float pointers so it can be used directly on OBS planes, and the
+ * scalar tail handles counts that are not a multiple of four.
+ */
+
+static inline float simdDotProduct(const float *a, const float *b, size_t count)
+{
+	__m128 sum    = _mm_setzero_ps();
+	size_t i      = 0;
+	size_t vector = count & ~(size_t)3;
+
+	for (; i < vector; i += 4) {
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+	}
+
+	float lanes[4];
+	_mm_storeu_ps(lanes, sum);
+	float result = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+
+	for (; i < count; i++) {
+		result += a[i] * b[i];
+	}
+
+	return result;
+}
+
+/*
+ * Writes the sum of all sources scaled by gain to dst, in a single pass over
+ * the data however many sources there are. dst may alias one of the sources.
+ */
+static inline void simdMix(float *dst, const float *const *sources, int numSources, float gain, size_t count)
+{
+	const __m128 scale = _mm_set1_ps(gain);
+
+	size_t i      = 0;
+	size_t vector = count & ~(size_t)3;
+
+	for (; i < vector; i += 4) {
+		__m128 sum = _mm_loadu_ps(sources[0] + i);
+		for (int source = 1; source < numSources; source++) {
+			sum = _mm_add_ps(sum, _mm_loadu_ps(sources[source] + i));
+		}
+		_mm_storeu_ps(dst + i, _mm_mul_ps(sum, scale));
+	}
+
+	for (; i < count; i++) {
+		float sum = sources[0][i];
+		for (int source = 1; source < numSources; source++) {
+			sum += sources[source][i];
+		}
+		dst[i] = sum * gain;
+	}
+}
+
+/*
+ * Widen and narrow planes for the 64-bit processing path. Four samples per
+ * step, two SSE2 conversions each way.
+ */
+static inline void simdFloatToDouble(double *dst, const float *src, size_t count)
+{
+	size_t i      = 0;
+	size_t vector = count & ~(size_t)3;
+
+	for (; i < vector; i += 4) {
+		__m128 x = _mm_loadu_ps(src + i);
+		_mm_storeu_pd(dst + i, _mm_cvtps_pd(x));
+		_mm_storeu_pd(dst + i + 2, _mm_cvtps_pd(_mm_movehl_ps(x, x)));
+	}
+
+	for (; i < count; i++) {
+		dst[i] = src[i];
+	}
+}
+
+static inline void simdDoubleToFloat(float *dst, const double *src, size_t count)
+{
+	size_t i      = 0;
+	size_t vector = count & ~(size_t)3;
+
+	for (; i < vector; i += 4) {
+		__m128 low  = _mm_cvtpd_ps(_mm_loadu_pd(src + i));
+		__m128 high = _mm_cvtpd_ps(_mm_loadu_pd(src + i + 2));
+		_mm_storeu_ps(dst + i, _mm_movelh_ps(low, high));
+	}
+
+	for (; i < count; i++) {
+		dst[i] = (float)src[i];
+	}
+}
+
+/*
+ * Replaces NaN and infinite samples with silence and flushes denormals to
+ * zero, so nothing a plug-in emits can poison later filters or the mix.
+ * Returns the number of non-finite samples that were replaced.
+ */
+static inline size_t simdSanitize(float *data, size_t count)
+{
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	const __m128 minimum = _mm_set1_ps(FLT_MIN);
+
+	size_t invalid = 0;
+	size_t i       = 0;
+	size_t vector  = count & ~(size_t)3;
+
+	for (; i < vector; i += 4) {
+		__m128 x = _mm_loadu_ps(data + i);
+		// x - x is NaN exactly when x is NaN or infinite
+		__m128 difference = _mm_sub_ps(x, x);
+		__m128 nonFinite  = _mm_cmpunord_ps(difference, difference);
+		__m128 tiny       = _mm_cmplt_ps(_mm_and_ps(x, absMask), minimum);
+
+		int mask = _mm_movemask_ps(nonFinite);
+		if (mask | _mm_movemask_ps(tiny)) {
+			invalid += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+			_mm_storeu_ps(data + i, _mm_andnot_ps(_mm_or_ps(nonFinite, tiny), x));
+		}
+	}
+
+	for (; i < count; i++) {
+		float difference = data[i] - data[i];
+		if (difference != difference) {
+			data[i] = 0.0f;
+			invalid++;
+		} else if (fabsf(data[i]) < FLT_MIN) {
+			data[i] = 0.0f;
+		}
+	}
+
+	return invalid;
+}
+
+/*
+ * Enables flush-to-zero and denormals-are-zero for the current thread while
+ * in scope, restoring the previous floating point mode afterwards.
+ */
+class ScopedFlushDenormals {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	unsigned int previous;
+
+public:
+	ScopedFlushDenormals() : previous(_mm_getcsr()) { _mm_setcsr(previous | 0x8040); }
+	~ScopedFlushDenormals() { _mm_setcsr(previous); }
+#elif defined(__aarch64__) && !defined(_MSC_VER)
+	uint64_t previous;
+
+public:
+	ScopedFlushDenormals()
+	{
+		__asm__ __volatile__("mrs %0, fpcr" : "=r"(previous));
+		uint64_t flushed = previous | (1ULL << 24);
+		__asm__ __volatile__("msr fpcr, %0" : : "r"(flushed));
+	}
+	~ScopedFlushDenormals() { __asm__ __volatile__("msr fpcr, %0" : : "r"(previous)); }
+#else
+public:
+	ScopedFlushDenormals() {}
+#endif
+
+	ScopedFlushDenormals(const ScopedFlushDenormals &) = delete;
+	ScopedFlushDenormals &operator=(const ScopedFlushDenormals &) = delete;
+};
+
+/*
+ * Zeroed planar buffers, one allocation per channel. Only used when a filter
+ * is configured, never from the audio thread.
+ */
+static inline float **allocPlanes(int numChannels, int frames)
+{
+	float **planes = (float **)malloc(sizeof(float *) * numChannels);
+	for (int channel = 0; channel < numChannels; channel++) {
+		planes[channel] = (float *)calloc(frames, sizeof(float));
+	}
+	return planes;
+}
+
+static inline void freePlanes(float **&planes, int numChannels)
+{
+	if (!planes) {
+		return;
+	}
+	for (int channel = 0; channel < numChannels; channel++) {
+		free(planes[channel]);
+	}
+	free(planes);
+	planes = nullptr;
+}
+
+// The same for the 64-bit path, calloc keeps them 16 byte aligned
+static inline double **allocDoublePlanes(int numChannels, int frames)
+{
+	double **planes = (double **)malloc(sizeof(double *) * numChannels);
+	for (int channel = 0; channel < numChannels; channel++) {
+		planes[channel] = (double *)calloc(frames, sizeof(double));
+	}
+	return planes;
+}
+
+static inline void freeDoublePlanes(double **&planes, int numChannels)
+{
+	if (!planes) {
+		return;
+	}
+	for (int channel = 0; channel < numChannels; channel++) {
+		free(planes[channel]);
+	}
+	free(planes);
+	planes = nullptr;
+}
+
+/*
+ * Kaiser window used by the FIR designs. position runs from -1 to 1 across
+ * the filter length.
+ */
+static inline double kaiserWindow(double position, double beta)
+{
+	// Zeroth order modified Bessel function, the series converges quickly
+	auto besselI0 = [](double x) {
+		double sum  = 1.0;
+		double term = 1.0;
+		for (int k = 1; k < 32; k++) {
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+		}
+		return sum;
+	};
+
+	if (position <= -1.0 || position >= 1.0) {
+		return besselI0(0.0) / besselI0(beta);
+	}
+	return besselI0(beta * sqrt(1.0 - position * position)) / besselI0(beta);
+}
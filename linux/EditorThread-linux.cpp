@@ -0,0 +1,418 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "../headers/EditorThread.h"
+#include "../headers/EditorWidget.h"
+#include "../headers/VSTPlugin.h"
+
+#include <util/platform.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <algorithm>
+
+// Xlib defines macros such as Bool and Status, keep it after the Qt headers
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+static thread_local bool onEditorThread = false;
+
+EditorThread &EditorThread::get()
+{
+	static EditorThread instance;
+	return instance;
+}
+
+EditorThread::~EditorThread()
+{
+	stop();
+}
+
+bool EditorThread::start()
+{
+	if (thread.joinable()) {
+		return true;
+	}
+
+	XInitThreads();
+	display = XOpenDisplay(nullptr);
+	if (!display) {
+		blog(LOG_WARNING, "VST Plug-in: No X display, editors are opened on the UI thread");
+		return false;
+	}
+
+	if (pipe(wakePipe) != 0) {
+		XCloseDisplay(display);
+		display = nullptr;
+		return false;
+	}
+	fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(wakePipe[1], F_SETFL, O_NONBLOCK);
+
+	deleteAtom = XInternAtom(display, "WM_DELETE_WINDOW", False);
+	stopping   = false;
+	thread     = std::thread(&EditorThread::loop, this);
+	return true;
+}
+
+void EditorThread::stop()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (!thread.joinable()) {
+			return;
+		}
+		stopping = true;
+	}
+
+	char wake = 0;
+	ssize_t written = write(wakePipe[1], &wake, 1);
+	UNUSED_PARAMETER(written);
+	thread.join();
+
+	::close(wakePipe[0]);
+	::close(wakePipe[1]);
+	wakePipe[0] = wakePipe[1] = -1;
+
+	XCloseDisplay(display);
+	display = nullptr;
+}
+
+void EditorThread::submit(Request request, bool wait)
+{
+	std::unique_lock<std::mutex> guard(lock);
+	requests.push_back(std::move(request));
+	uint64_t ticket = ++submitted;
+
+	char wake = 0;
+	ssize_t written = write(wakePipe[1], &wake, 1);
+	UNUSED_PARAMETER(written);
+
+	if (wait) {
+		done.wait(guard, [&] { return handled >= ticket; });
+	}
+}
+
+bool EditorThread::open(VSTPlugin *owner, AEffect *effect, const std::string &title)
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (!start()) {
+			return false;
+		}
+		openEffects.push_back(effect);
+	}
+
+	// Not waited for, effEditOpen of a heavy GUI takes a while
+	submit({Open, owner, effect, title, 0, 0}, false);
+	return true;
+}
+
+void EditorThread::close(AEffect *effect)
+{
+	{
+		// The editor thread drops the entry under the same lock, so an
+		// editor the user just closed is either still listed here or gone
+		// including the notification to its owner.
+		std::lock_guard<std::mutex> guard(lock);
+		if (std::find(openEffects.begin(), openEffects.end(), effect) == openEffects.end()) {
+			return;
+		}
+		openEffects.erase(std::find(openEffects.begin(), openEffects.end(), effect));
+	}
+
+	// Waited for, the plug-in may be unloaded right after this returns
+	submit({Close, nullptr, effect, std::string(), 0, 0}, true);
+}
+
+void EditorThread::setTitle(AEffect *effect, const std::string &title)
+{
+	submit({SetTitle, nullptr, effect, title, 0, 0}, false);
+}
+
+bool EditorThread::isOpen(AEffect *effect)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	return std::find(openEffects.begin(), openEffects.end(), effect) != openEffects.end();
+}
+
+std::unique_lock<std::mutex> EditorThread::lockCalls(AEffect *effect)
+{
+	// Editors are only opened from the UI thread, so one that is not listed
+	// can't start while the caller talks to the effect
+	if (!isOpen(effect)) {
+		return std::unique_lock<std::mutex>(callLock, std::defer_lock);
+	}
+	return std::unique_lock<std::mutex>(callLock);
+}
+
+void EditorThread::resize(AEffect *effect, int width, int height)
+{
+	if (!onEditorThread) {
+		submit({Resize, nullptr, effect, std::string(), width, height}, false);
+		return;
+	}
+
+	// Plug-ins usually ask from inside effEditOpen or effEditIdle
+	Editor *editor = findEditor(effect);
+	if (editor) {
+		resizeWindow(*editor, width, height);
+	}
+}
+
+EditorThread::Editor *EditorThread::findEditor(AEffect *effect)
+{
+	for (Editor &editor : editors) {
+		if (editor.effect == effect) {
+			return &editor;
+		}
+	}
+	return nullptr;
+}
+
+bool EditorThread::anyVisible() const
+{
+	for (const Editor &editor : editors) {
+		if (editor.mapped && !editor.obscured) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void EditorThread::resizeWindow(Editor &editor, int width, int height)
+{
+	if (width <= 0 || height <= 0) {
+		return;
+	}
+
+	// Plug-in editors have a fixed size, keep window managers from changing it
+	XSizeHints *hints = XAllocSizeHints();
+	hints->flags      = PMinSize | PMaxSize;
+	hints->min_width  = hints->max_width  = width;
+	hints->min_height = hints->max_height = height;
+	XSetWMNormalHints(display, editor.window, hints);
+	XFree(hints);
+
+	XResizeWindow(display, editor.window, width, height);
+}
+
+void EditorThread::openEditor(const Request &request)
+{
+	Editor editor;
+	editor.owner  = request.owner;
+	editor.effect = request.effect;
+	editor.window = XCreateSimpleWindow(display, DefaultRootWindow(display), 0, 0, 300, 200, 0, 0, 0);
+
+	XSelectInput(display, editor.window, StructureNotifyMask | VisibilityChangeMask);
+	XSetWMProtocols(display, editor.window, &deleteAtom, 1);
+	Xutf8SetWMProperties(display, editor.window, request.title.c_str(), request.title.c_str(), nullptr, 0,
+	                     nullptr, nullptr, nullptr);
+
+	editors.push_back(editor);
+
+	AEffect *effect  = request.effect;
+	VstRect *vstRect = nullptr;
+	{
+		std::lock_guard<std::mutex> calls(callLock);
+		effect->dispatcher(effect, effEditOpen, 0, 0, (void *)editors.back().window, 0);
+		effect->dispatcher(effect, effEditGetRect, 0, 0, &vstRect, 0);
+	}
+
+	// effEditOpen may have resized the window already, look the editor up again
+	Editor *opened = findEditor(effect);
+	if (vstRect) {
+		resizeWindow(*opened, vstRect->right - vstRect->left, vstRect->bottom - vstRect->top);
+	}
+	XMapRaised(display, opened->window);
+	XFlush(display);
+}
+
+void EditorThread::closeEditor(size_t index, bool notify)
+{
+	Editor editor = editors[index];
+	editors.erase(editors.begin() + index);
+
+	{
+		std::lock_guard<std::mutex> calls(callLock);
+		editor.effect->dispatcher(editor.effect, effEditClose, 0, 0, nullptr, 0);
+	}
+	XDestroyWindow(display, editor.window);
+	XFlush(display);
+
+	if (notify) {
+		// Closed by the user, the owner still has to pick up edits made in
+		// the GUI. Posted under the lock so close() can not return, and the
+		// owner be deleted, before the notification is queued.
+		std::lock_guard<std::mutex> guard(lock);
+		auto listed = std::find(openEffects.begin(), openEffects.end(), editor.effect);
+		if (listed != openEffects.end()) {
+			openEffects.erase(listed);
+			QMetaObject::invokeMethod(editor.owner, "editorClosed", Qt::QueuedConnection);
+		}
+	}
+}
+
+void EditorThread::handleRequest(const Request &request)
+{
+	switch (request.type) {
+	case Open:
+		openEditor(request);
+		break;
+
+	case Close:
+		for (size_t i = 0; i < editors.size(); i++) {
+			if (editors[i].effect == request.effect) {
+				closeEditor(i, false);
+				break;
+			}
+		}
+		break;
+
+	case SetTitle: {
+		Editor *editor = findEditor(request.effect);
+		if (editor) {
+			Xutf8SetWMProperties(display, editor->window, request.title.c_str(), request.title.c_str(),
+			                     nullptr, 0, nullptr, nullptr, nullptr);
+		}
+		break;
+	}
+
+	case Resize: {
+		Editor *editor = findEditor(request.effect);
+		if (editor) {
+			resizeWindow(*editor, request.width, request.height);
+		}
+		break;
+	}
+	}
+}
+
+void EditorThread::handleEvents()
+{
+	while (XPending(display)) {
+		XEvent event;
+		XNextEvent(display, &event);
+
+		for (size_t i = 0; i < editors.size(); i++) {
+			Editor &editor = editors[i];
+			if (editor.window != event.xany.window) {
+				continue;
+			}
+
+			switch (event.type) {
+			case MapNotify:
+				editor.mapped = true;
+				break;
+			case UnmapNotify:
+				// Minimised or moved to another desktop
+				editor.mapped = false;
+				break;
+			case VisibilityNotify:
+				editor.obscured = event.xvisibility.state == VisibilityFullyObscured;
+				break;
+			case ClientMessage:
+				if ((unsigned long)event.xclient.data.l[0] == deleteAtom) {
+					closeEditor(i, true);
+				}
+				break;
+			}
+			break;
+		}
+	}
+}
+
+void EditorThread::idleEditors()
+{
+	for (size_t i = 0; i < editors.size(); i++) {
+		Editor &editor = editors[i];
+		if (editor.mapped && !editor.obscured) {
+			std::lock_guard<std::mutex> calls(callLock);
+			editor.effect->dispatcher(editor.effect, effEditIdle, 0, 0, nullptr, 0);
+		}
+	}
+}
+
+void EditorThread::loop()
+{
+	onEditorThread    = true;
+	uint64_t nextIdle = 0;
+
+	for (;;) {
+		std::vector<Request> pending;
+		bool                 exiting;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			pending.swap(requests);
+			exiting = stopping;
+		}
+
+		char drain[64];
+		while (read(wakePipe[0], drain, sizeof(drain)) > 0) {
+		}
+
+		for (const Request &request : pending) {
+			handleRequest(request);
+		}
+
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			handled += pending.size();
+		}
+		done.notify_all();
+
+		if (exiting) {
+			break;
+		}
+
+		handleEvents();
+
+		int timeout = -1;
+		if (anyVisible()) {
+			uint64_t now = os_gettime_ns();
+			if (now >= nextIdle) {
+				idleEditors();
+
+				// Back off when the GUIs get expensive to idle
+				uint64_t finished = os_gettime_ns();
+				uint64_t minimum  = EDITOR_IDLE_MIN_MS * 1000000ULL;
+				uint64_t maximum  = EDITOR_IDLE_MAX_MS * 1000000ULL;
+				uint64_t target   = (finished - now) * EDITOR_IDLE_LOAD_DIVISOR;
+				target            = target < minimum ? minimum : target > maximum ? maximum : target;
+				idleInterval      = (idleInterval * 3 + target) / 4;
+				nextIdle          = finished + idleInterval;
+				now               = finished;
+			}
+			timeout = (int)((nextIdle - now + 999999) / 1000000);
+		}
+
+		// Also flushes, events read ahead by Xlib would never wake poll()
+		if (XPending(display)) {
+			timeout = 0;
+		}
+
+		struct pollfd fds[2] = {{ConnectionNumber(display), POLLIN, 0}, {wakePipe[0], POLLIN, 0}};
+		poll(fds, 2, timeout);
+	}
+
+	// Module unload, the filters should have closed their editors already
+	while (!editors.empty()) {
+		closeEditor(editors.size() - 1, false);
+	}
+}
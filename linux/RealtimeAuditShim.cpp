@@ -0,0 +1,373 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+/*
+ * LD_PRELOAD shim for the real-time safety audit, see headers/RealtimeAudit.h.
+ *
+ *   LD_PRELOAD=libobs-vst-rt-audit.so obs
+ *
+ * Every wrapped call made on a thread that currently has an owner is counted
+ * against that owner. The first violation of each kind is reported on stderr
+ * right away, a summary follows when the process exits. Nothing in here may
+ * allocate, the counters live in a fixed table.
+ */
+
+#include <atomic>
+#include <dlfcn.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define AUDIT_MAX_OWNERS 64
+#define AUDIT_OWNER_LENGTH 64
+#define AUDIT_BOOTSTRAP_SIZE 8192
+
+#define AUDIT_EXPORT extern "C" __attribute__((visibility("default")))
+#define AUDIT_TLS __thread __attribute__((tls_model("initial-exec")))
+
+enum AuditKind {
+	AuditAllocate,
+	AuditFree,
+	AuditLock,
+	AuditWait,
+	AuditSleep,
+	AuditIo,
+	AuditKindCount
+};
+
+static const char *kindNames[AuditKindCount] = {"allocate", "free", "mutex lock", "condition wait", "sleep", "I/O"};
+
+struct AuditOwner {
+	char                  name[AUDIT_OWNER_LENGTH];
+	std::atomic<uint64_t> counts[AuditKindCount];
+};
+
+static AuditOwner       owners[AUDIT_MAX_OWNERS];
+static std::atomic<int> ownerCount{0};
+static std::atomic_flag ownersLock = ATOMIC_FLAG_INIT;
+
+static AUDIT_TLS const char *currentOwner = nullptr;
+static AUDIT_TLS bool        inAudit      = false;
+
+/* Real implementations ------------------------------------------------------ */
+
+typedef void *(*mallocFunc)(size_t);
+typedef void *(*callocFunc)(size_t, size_t);
+typedef void *(*reallocFunc)(void *, size_t);
+typedef void (*freeFunc)(void *);
+typedef int (*memalignFunc)(void **, size_t, size_t);
+typedef int (*mutexLockFunc)(pthread_mutex_t *);
+typedef int (*condWaitFunc)(pthread_cond_t *, pthread_mutex_t *);
+typedef int (*condTimedWaitFunc)(pthread_cond_t *, pthread_mutex_t *, const struct timespec *);
+typedef int (*nanosleepFunc)(const struct timespec *, struct timespec *);
+typedef int (*usleepFunc)(useconds_t);
+typedef ssize_t (*readFunc)(int, void *, size_t);
+typedef ssize_t (*writeFunc)(int, const void *, size_t);
+typedef int (*pollFunc)(struct pollfd *, nfds_t, int);
+
+static mallocFunc        realMalloc;
+static callocFunc        realCalloc;
+static reallocFunc       realRealloc;
+static freeFunc          realFree;
+static memalignFunc      realMemalign;
+static mutexLockFunc     realMutexLock;
+static condWaitFunc      realCondWait;
+static condTimedWaitFunc realCondTimedWait;
+static nanosleepFunc     realNanosleep;
+static usleepFunc        realUsleep;
+static readFunc          realRead;
+static writeFunc         realWrite;
+static pollFunc          realPoll;
+
+// dlsym() may allocate, those requests are served from here while resolving
+static char   bootstrap[AUDIT_BOOTSTRAP_SIZE];
+static size_t bootstrapUsed = 0;
+static bool   resolving     = false;
+
+static void *bootstrapAlloc(size_t size)
+{
+	size = (size + 15) & ~(size_t)15;
+	if (bootstrapUsed + size > sizeof(bootstrap)) {
+		return nullptr;
+	}
+
+	void *memory = bootstrap + bootstrapUsed;
+	bootstrapUsed += size;
+	return memory;
+}
+
+static bool isBootstrap(void *memory)
+{
+	return (char *)memory >= bootstrap && (char *)memory < bootstrap + sizeof(bootstrap);
+}
+
+static void *lookup(const char *name, const char *version = nullptr)
+{
+	// The condition variable functions exist in two versions, pick the current one
+	void *symbol = version ? dlvsym(RTLD_NEXT, name, version) : nullptr;
+	return symbol ? symbol : dlsym(RTLD_NEXT, name);
+}
+
+static void resolve()
+{
+	if (realFree || resolving) {
+		return;
+	}
+
+	resolving = true;
+
+	realMalloc        = (mallocFunc)lookup("malloc");
+	realCalloc        = (callocFunc)lookup("calloc");
+	realRealloc       = (reallocFunc)lookup("realloc");
+	realMemalign      = (memalignFunc)lookup("posix_memalign");
+	realMutexLock     = (mutexLockFunc)lookup("pthread_mutex_lock");
+	realCondWait      = (condWaitFunc)lookup("pthread_cond_wait", "GLIBC_2.3.2");
+	realCondTimedWait = (condTimedWaitFunc)lookup("pthread_cond_timedwait", "GLIBC_2.3.2");
+	realNanosleep     = (nanosleepFunc)lookup("nanosleep");
+	realUsleep        = (usleepFunc)lookup("usleep");
+	realRead          = (readFunc)lookup("read");
+	realWrite         = (writeFunc)lookup("write");
+	realPoll          = (pollFunc)lookup("poll");
+	realFree          = (freeFunc)lookup("free");
+
+	resolving = false;
+}
+
+/* Bookkeeping --------------------------------------------------------------- */
+
+static AuditOwner *findOwner(const char *name)
+{
+	int count = ownerCount.load(std::memory_order_acquire);
+	for (int i = 0; i < count; i++) {
+		if (strncmp(owners[i].name, name, AUDIT_OWNER_LENGTH - 1) == 0) {
+			return &owners[i];
+		}
+	}
+
+	// Only taken the first time an owner misbehaves
+	while (ownersLock.test_and_set(std::memory_order_acquire)) {
+	}
+
+	AuditOwner *owner = nullptr;
+	for (int i = count; i < ownerCount.load(std::memory_order_relaxed); i++) {
+		if (strncmp(owners[i].name, name, AUDIT_OWNER_LENGTH - 1) == 0) {
+			owner = &owners[i];
+		}
+	}
+
+	count = ownerCount.load(std::memory_order_relaxed);
+	if (!owner && count < AUDIT_MAX_OWNERS) {
+		owner = &owners[count];
+		strncpy(owner->name, name, AUDIT_OWNER_LENGTH - 1);
+		ownerCount.store(count + 1, std::memory_order_release);
+	}
+
+	ownersLock.clear(std::memory_order_release);
+	return owner;
+}
+
+static void report(const char *line, int length)
+{
+	if (length > 0 && realWrite) {
+		realWrite(STDERR_FILENO, line, (size_t)length);
+	}
+}
+
+static void record(AuditKind kind)
+{
+	const char *owner = currentOwner;
+	if (!owner || inAudit) {
+		return;
+	}
+
+	inAudit = true;
+
+	AuditOwner *entry = findOwner(owner);
+	if (entry && entry->counts[kind]++ == 0) {
+		char line[256];
+		int  length = snprintf(line,
+		                       sizeof(line),
+		                       "obs-vst audit: %s: %s on the audio thread\n",
+		                       entry->name,
+		                       kindNames[kind]);
+		report(line, length);
+	}
+
+	inAudit = false;
+}
+
+__attribute__((constructor)) static void auditLoad()
+{
+	resolve();
+}
+
+__attribute__((destructor)) static void auditUnload()
+{
+	currentOwner = nullptr;
+
+	int count = ownerCount.load(std::memory_order_acquire);
+	for (int i = 0; i < count; i++) {
+		char line[512];
+		int  length = snprintf(line, sizeof(line), "obs-vst audit summary: %s:", owners[i].name);
+
+		for (int kind = 0; kind < AuditKindCount; kind++) {
+			uint64_t calls = owners[i].counts[kind];
+			if (calls && length < (int)sizeof(line)) {
+				length += snprintf(line + length,
+				                   sizeof(line) - length,
+				                   " %s %llu",
+				                   kindNames[kind],
+				                   (unsigned long long)calls);
+			}
+		}
+
+		if (length < (int)sizeof(line) - 1) {
+			line[length++] = '\n';
+		}
+		report(line, length < (int)sizeof(line) ? length : (int)sizeof(line) - 1);
+	}
+}
+
+/* Interface used by the filter --------------------------------------------- */
+
+AUDIT_EXPORT const char *obs_vst_audit_swap_owner(const char *owner)
+{
+	const char *previous = currentOwner;
+	currentOwner         = owner;
+	return previous;
+}
+
+/* Wrappers ------------------------------------------------------------------ */
+
+AUDIT_EXPORT void *malloc(size_t size) noexcept
+{
+	resolve();
+	if (!realMalloc) {
+		return bootstrapAlloc(size);
+	}
+
+	record(AuditAllocate);
+	return realMalloc(size);
+}
+
+AUDIT_EXPORT void *calloc(size_t count, size_t size) noexcept
+{
+	resolve();
+	if (!realCalloc) {
+		// Static storage is already zeroed
+		return bootstrapAlloc(count * size);
+	}
+
+	record(AuditAllocate);
+	return realCalloc(count, size);
+}
+
+AUDIT_EXPORT void *realloc(void *memory, size_t size) noexcept
+{
+	resolve();
+	record(AuditAllocate);
+
+	if (isBootstrap(memory)) {
+		void *moved = realMalloc(size);
+		if (moved) {
+			size_t available = bootstrap + sizeof(bootstrap) - (char *)memory;
+			memcpy(moved, memory, size < available ? size : available);
+		}
+		return moved;
+	}
+
+	return realRealloc(memory, size);
+}
+
+AUDIT_EXPORT void free(void *memory) noexcept
+{
+	if (!memory || isBootstrap(memory)) {
+		return;
+	}
+
+	resolve();
+	record(AuditFree);
+	realFree(memory);
+}
+
+AUDIT_EXPORT int posix_memalign(void **memory, size_t alignment, size_t size) noexcept
+{
+	resolve();
+	record(AuditAllocate);
+	return realMemalign(memory, alignment, size);
+}
+
+AUDIT_EXPORT int pthread_mutex_lock(pthread_mutex_t *mutex) noexcept
+{
+	resolve();
+	record(AuditLock);
+	return realMutexLock(mutex);
+}
+
+AUDIT_EXPORT int pthread_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex)
+{
+	resolve();
+	record(AuditWait);
+	return realCondWait(cond, mutex);
+}
+
+AUDIT_EXPORT int pthread_cond_timedwait(pthread_cond_t *cond, pthread_mutex_t *mutex, const struct timespec *time)
+{
+	resolve();
+	record(AuditWait);
+	return realCondTimedWait(cond, mutex, time);
+}
+
+AUDIT_EXPORT int nanosleep(const struct timespec *request, struct timespec *remaining)
+{
+	resolve();
+	record(AuditSleep);
+	return realNanosleep(request, remaining);
+}
+
+AUDIT_EXPORT int usleep(useconds_t usec)
+{
+	resolve();
+	record(AuditSleep);
+	return realUsleep(usec);
+}
+
+AUDIT_EXPORT ssize_t read(int fd, void *buffer, size_t count)
+{
+	resolve();
+	record(AuditIo);
+	return realRead(fd, buffer, count);
+}
+
+AUDIT_EXPORT ssize_t write(int fd, const void *buffer, size_t count)
+{
+	resolve();
+	record(AuditIo);
+	return realWrite(fd, buffer, count);
+}
+
+AUDIT_EXPORT int poll(struct pollfd *fds, nfds_t count, int timeout)
+{
+	resolve();
+	record(AuditIo);
+	return realPoll(fds, count, timeout);
+}
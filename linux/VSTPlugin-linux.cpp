@@ -50,6 +50,9 @@ AEffect* VSTPlugin::loadEffect()
 		return nullptr;
 	}
 
+	// Kept for further instances, see createPairs()
+	mainEntry = mainEntryPoint;
+
 	// Instantiate the plug-in
 	plugin       = mainEntryPoint(hostCallback_static);
 	plugin->user = this;
@@ -58,6 +58,9 @@ AEffect *VSTPlugin::loadEffect() {
     return NULL;
   }
 
+  // Kept for further instances, see createPairs()
+  mainEntry = mainEntryPoint;
+
   newEffect = mainEntryPoint(hostCallback_static);
   if (newEffect == NULL) {
     blog(LOG_WARNING, "VST Plug-in's main() returns null.");
@@ -17,15 +17,86 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *****************************************************************************/
 
 #include "headers/VSTPlugin.h"
+#include "headers/LinkedInstances.h"
+#include "headers/LoadGovernor.h"
+#include "headers/MetricsExporter.h"
+#include "headers/PluginProfiles.h"
+#include "headers/vst-simd.hpp"
+
+#include <util/platform.h>
+#ifdef __linux__
+#include "headers/EditorThread.h"
+#endif
 
 #define OPEN_VST_SETTINGS "open_vst_settings"
 #define CLOSE_VST_SETTINGS "close_vst_settings"
 #define OPEN_WHEN_ACTIVE_VST_SETTINGS "open_when_active_vst_settings"
+#define OVERSAMPLING_VST_SETTINGS "oversampling"
+#define INTERNAL_RATE_VST_SETTINGS "internal_sample_rate"
+#define ACCUMULATION_VST_SETTINGS "accumulation_frames"
+#define STEREO_PAIRS_VST_SETTINGS "stereo_pairs"
+#define DOUBLE_PRECISION_VST_SETTINGS "double_precision"
+#define INPUT_ROUTING_VST_SETTINGS "input_routing"
+#define OUTPUT_ROUTING_VST_SETTINGS "output_routing"
+#define SIDECHAIN_VST_SETTINGS "sidechain_source"
+#define RESET_ON_INVALID_VST_SETTINGS "reset_on_invalid_output"
+#define DEADLINE_BUDGET_VST_SETTINGS "deadline_budget"
+#define DEADLINE_MISSES_VST_SETTINGS "deadline_misses"
+#define SMOOTHING_VST_SETTINGS "parameter_smoothing"
+#define FLIGHT_RECORDER_VST_SETTINGS "flight_recorder_seconds"
+#define MIDI_CHANNEL_VST_SETTINGS "midi_channel"
+#define MIDI_NOTE_VST_SETTINGS "midi_note"
+#define MIDI_VELOCITY_VST_SETTINGS "midi_velocity"
+#define LINKED_VST_SETTINGS "linked_instance"
+#define LINK_ID_VST_SETTINGS "link_id"
+#define SHED_PRIORITY_VST_SETTINGS "shed_priority"
+#define PROFILE_PLUGINS_VST_SETTINGS "profile_plugins"
+#define STATISTICS_VST_SETTINGS "vst_statistics"
+#define REFRESH_STATISTICS_VST_SETTINGS "refresh_vst_statistics"
 
 #define PLUG_IN_NAME obs_module_text("VstPlugin")
 #define OPEN_VST_TEXT obs_module_text("OpenPluginInterface")
 #define CLOSE_VST_TEXT obs_module_text("ClosePluginInterface")
 #define OPEN_WHEN_ACTIVE_VST_TEXT obs_module_text("OpenInterfaceWhenActive")
+#define OVERSAMPLING_VST_TEXT obs_module_text("Oversampling")
+#define OVERSAMPLING_NONE_TEXT obs_module_text("OversamplingNone")
+#define OVERSAMPLING_2X_TEXT obs_module_text("Oversampling2x")
+#define OVERSAMPLING_4X_TEXT obs_module_text("Oversampling4x")
+#define INTERNAL_RATE_VST_TEXT obs_module_text("InternalSampleRate")
+#define INTERNAL_RATE_SAME_TEXT obs_module_text("InternalSampleRateSame")
+#define ACCUMULATION_VST_TEXT obs_module_text("BlockAccumulation")
+#define ACCUMULATION_NONE_TEXT obs_module_text("BlockAccumulationNone")
+#define ACCUMULATION_VST_HELP obs_module_text("BlockAccumulation.Help")
+#define STEREO_PAIRS_VST_TEXT obs_module_text("StereoPairs")
+#define DOUBLE_PRECISION_VST_TEXT obs_module_text("DoublePrecision")
+#define INPUT_ROUTING_VST_TEXT obs_module_text("InputRouting")
+#define INPUT_ROUTING_VST_HELP obs_module_text("InputRouting.Help")
+#define OUTPUT_ROUTING_VST_TEXT obs_module_text("OutputRouting")
+#define OUTPUT_ROUTING_VST_HELP obs_module_text("OutputRouting.Help")
+#define SIDECHAIN_VST_TEXT obs_module_text("SidechainSource")
+#define SIDECHAIN_NONE_TEXT obs_module_text("SidechainNone")
+#define RESET_ON_INVALID_VST_TEXT obs_module_text("ResetOnInvalidOutput")
+#define DEADLINE_BUDGET_VST_TEXT obs_module_text("DeadlineBudget")
+#define DEADLINE_MISSES_VST_TEXT obs_module_text("DeadlineMisses")
+#define SMOOTHING_VST_TEXT obs_module_text("ParameterSmoothing")
+#define FLIGHT_RECORDER_VST_TEXT obs_module_text("FlightRecorder")
+#define FLIGHT_RECORDER_HOTKEY_TEXT obs_module_text("FlightRecorderHotkey")
+#define MIDI_CHANNEL_VST_TEXT obs_module_text("MidiChannel")
+#define MIDI_NOTE_VST_TEXT obs_module_text("MidiNote")
+#define MIDI_VELOCITY_VST_TEXT obs_module_text("MidiVelocity")
+#define MIDI_NOTE_HOTKEY_TEXT obs_module_text("MidiNoteHotkey")
+#define MIDI_SUSTAIN_HOTKEY_TEXT obs_module_text("MidiSustainHotkey")
+#define LINKED_VST_TEXT obs_module_text("LinkedInstance")
+#define LINK_ID_VST_TEXT obs_module_text("LinkId")
+#define SHED_PRIORITY_VST_TEXT obs_module_text("ShedPriority")
+#define SHED_PRIORITY_VST_HELP obs_module_text("ShedPriority.Help")
+#define SHED_PRIORITY_NEVER_TEXT obs_module_text("ShedPriorityNever")
+#define SHED_PRIORITY_FIRST_TEXT obs_module_text("ShedPriorityFirst")
+#define SHED_PRIORITY_LAST_TEXT obs_module_text("ShedPriorityLast")
+#define PROFILE_PLUGINS_VST_TEXT obs_module_text("ProfilePlugins")
+#define PROFILE_PLUGINS_VST_HELP obs_module_text("ProfilePlugins.Help")
+#define STATISTICS_VST_TEXT obs_module_text("Statistics")
+#define REFRESH_STATISTICS_VST_TEXT obs_module_text("RefreshStatistics")
 
 OBS_DECLARE_MODULE()
 OBS_MODULE_USE_DEFAULT_LOCALE("obs-vst", "en-US")
@@ -34,11 +105,57 @@ MODULE_EXPORT const char *obs_module_description(void)
 	return "VST 2.x Plug-in filter";
 }
 
+/*
+ * Per filter state. The plug-in instance is either owned by the filter or, in
+ * linked mode, shared with other filters, so whatever belongs to one filter
+ * in particular lives here.
+ */
+struct vst_filter {
+	obs_source_t *context = nullptr;
+
+	// Swapped under pluginLock, read without it by the threads that never
+	// process audio. A replaced instance lives on until deleteLater runs.
+	std::atomic<VSTPlugin *> plugin{nullptr};
+
+	// Held while the filter attaches to or detaches from a plug-in and while
+	// enabled, active and running change. Never taken on the audio thread.
+	std::mutex stateLock;
+
+	bool        linked = false;
+	std::string linkPath;
+	std::string linkId;
+
+	bool enabled = true;
+	bool active  = true;
+	bool running = false;
+
+	// Filters are created before they are added to their source, active only
+	// follows the parent once it could be read from it
+	std::atomic<bool> parentKnown{false};
+
+	// Held only while plugin, linked and the fade planes are replaced. The
+	// audio thread only tries it and passes the packet through when taken.
+	std::mutex pluginLock;
+
+	// Set when a sidechain source is configured, vst_tick skips it otherwise
+	std::atomic<bool> sidechained{false};
+
+	obs_hotkey_id noteHotkey     = OBS_INVALID_HOTKEY_ID;
+	obs_hotkey_id sustainHotkey  = OBS_INVALID_HOTKEY_ID;
+	obs_hotkey_id recorderHotkey = OBS_INVALID_HOTKEY_ID;
+
+	// Load shedding. bypassed follows governed.shed on the audio thread,
+	// fadePlanes keep the dry signal while crossfading between the two.
+	GovernedFilter governed;
+	bool           bypassed   = false;
+	float **       fadePlanes = nullptr;
+};
+
 static bool open_editor_button_clicked(obs_properties_t *props, obs_property_t *property, void *data)
 {
-	VSTPlugin *vstPlugin = (VSTPlugin *)data;
+	struct vst_filter *filter = (struct vst_filter *)data;
 
-	QMetaObject::invokeMethod(vstPlugin, "openEditor");
+	QMetaObject::invokeMethod(filter->plugin.load(), "openEditor");
 
 	obs_property_set_visible(obs_properties_get(props, OPEN_VST_SETTINGS), false);
 	obs_property_set_visible(obs_properties_get(props, CLOSE_VST_SETTINGS), true);
@@ -52,9 +169,9 @@ static bool open_editor_button_clicked(obs_properties_t *props, obs_property_t *
 
 static bool close_editor_button_clicked(obs_properties_t *props, obs_property_t *property, void *data)
 {
-	VSTPlugin *vstPlugin = (VSTPlugin *)data;
+	struct vst_filter *filter = (struct vst_filter *)data;
 
-	QMetaObject::invokeMethod(vstPlugin, "closeEditor");
+	QMetaObject::invokeMethod(filter->plugin.load(), "closeEditor");
 
 	obs_property_set_visible(obs_properties_get(props, OPEN_VST_SETTINGS), true);
 	obs_property_set_visible(obs_properties_get(props, CLOSE_VST_SETTINGS), false);
@@ -64,69 +181,438 @@ static bool close_editor_button_clicked(obs_properties_t *props, obs_property_t
 	return true;
 }
 
+static bool refresh_statistics_clicked(obs_properties_t *props, obs_property_t *property, void *data)
+{
+	UNUSED_PARAMETER(props);
+	UNUSED_PARAMETER(property);
+	UNUSED_PARAMETER(data);
+
+	// Returning true makes OBS rebuild the properties, which refreshes the text
+	return true;
+}
+
 static const char *vst_name(void *unused)
 {
 	UNUSED_PARAMETER(unused);
 	return PLUG_IN_NAME;
 }
 
+// Called with stateLock held
+static void vst_update_running(struct vst_filter *filter)
+{
+	VSTPlugin *vstPlugin = filter->plugin;
+	bool       running   = filter->enabled && filter->active;
+
+	if (!filter->linked) {
+		vstPlugin->setEnabled(filter->enabled);
+		vstPlugin->setTargetActive(filter->active);
+	} else if (running != filter->running) {
+		setLinkedInstanceRunning(vstPlugin, filter->context, running);
+	}
+
+	filter->running = running;
+}
+
+// Called with stateLock held
+static void vst_check_parent(struct vst_filter *filter)
+{
+	obs_source_t *parent = obs_filter_get_parent(filter->context);
+	if (filter->parentKnown || !parent) {
+		return;
+	}
+
+	filter->parentKnown = true;
+	filter->active      = obs_source_active(parent);
+	vst_update_running(filter);
+}
+
+/*
+ * Called with stateLock held. Returns the filter that owns the linked instance
+ * now if that changed, the caller has it put its processing options back on
+ * the instance with obs_source_update() once it holds none of its own locks.
+ */
+static obs_source_t *vst_detach(struct vst_filter *filter)
+{
+	VSTPlugin *   vstPlugin = filter->plugin;
+	obs_source_t *owner     = nullptr;
+	if (!vstPlugin) {
+		return nullptr;
+	}
+
+	{
+		// Once the swap has the lock the audio thread is done with the instance
+		std::lock_guard<std::mutex> lock(filter->pluginLock);
+		filter->plugin = nullptr;
+	}
+
+	metricsRemove(filter->context);
+	if (filter->linked) {
+		owner = releaseLinkedInstance(vstPlugin, filter->context);
+	} else {
+		QMetaObject::invokeMethod(vstPlugin, "closeEditor");
+		vstPlugin->deleteLater();
+	}
+
+	filter->running = false;
+	return owner;
+}
+
+static void vst_filter_enabled(void *data, calldata_t *calldata)
+{
+	struct vst_filter *         filter = (struct vst_filter *)data;
+	std::lock_guard<std::mutex> lock(filter->stateLock);
+
+	filter->enabled = calldata_bool(calldata, "enabled");
+	vst_update_running(filter);
+}
+
+static void vst_source_activated(struct vst_filter *filter, calldata_t *calldata, bool active)
+{
+	// These come from the global handler, only react to our own parent
+	obs_source_t *source = (obs_source_t *)calldata_ptr(calldata, "source");
+	obs_source_t *parent = obs_filter_get_parent(filter->context);
+
+	if (source && source == parent) {
+		std::lock_guard<std::mutex> lock(filter->stateLock);
+
+		filter->active = active;
+		vst_update_running(filter);
+	}
+}
+
+static void vst_source_activate(void *data, calldata_t *calldata)
+{
+	vst_source_activated((struct vst_filter *)data, calldata, true);
+}
+
+static void vst_source_deactivate(void *data, calldata_t *calldata)
+{
+	vst_source_activated((struct vst_filter *)data, calldata, false);
+}
+
+static void vst_source_renamed(void *data, calldata_t *calldata)
+{
+	struct vst_filter *filter = (struct vst_filter *)data;
+	obs_source_t *     source = (obs_source_t *)calldata_ptr(calldata, "source");
+
+	// The names only end up in the editor title, refresh them on the UI thread
+	if (source && (source == filter->context || source == obs_filter_get_parent(filter->context))) {
+		VSTPlugin *vstPlugin = filter->plugin;
+		if (vstPlugin) {
+			QMetaObject::invokeMethod(vstPlugin, "updateSourceNames");
+		}
+	}
+}
+
+static void vst_note_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
+{
+	UNUSED_PARAMETER(id);
+	UNUSED_PARAMETER(hotkey);
+
+	struct vst_filter *filter    = (struct vst_filter *)data;
+	VSTPlugin *        vstPlugin = filter->plugin;
+	if (!vstPlugin) {
+		return;
+	}
+
+	// Held down plays the note, releasing the key stops it
+	uint8_t status = (pressed ? 0x90 : 0x80) | (uint8_t)(vstPlugin->midiChannel & 0x0F);
+	vstPlugin->queueMidi(status, (uint8_t)vstPlugin->midiNote, pressed ? (uint8_t)vstPlugin->midiVelocity : 0);
+}
+
+static void vst_sustain_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
+{
+	UNUSED_PARAMETER(id);
+	UNUSED_PARAMETER(hotkey);
+
+	struct vst_filter *filter    = (struct vst_filter *)data;
+	VSTPlugin *        vstPlugin = filter->plugin;
+	if (!vstPlugin) {
+		return;
+	}
+
+	// Controller 64 is the sustain pedal
+	vstPlugin->queueMidi(0xB0 | (uint8_t)(vstPlugin->midiChannel & 0x0F), 64, pressed ? 127 : 0);
+}
+
+static void vst_recorder_hotkey(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
+{
+	UNUSED_PARAMETER(id);
+	UNUSED_PARAMETER(hotkey);
+
+	struct vst_filter *filter    = (struct vst_filter *)data;
+	VSTPlugin *        vstPlugin = filter->plugin;
+
+	if (pressed && vstPlugin) {
+		vstPlugin->dumpFlightRecorder();
+	}
+}
+
+static void vst_connect_signals(struct vst_filter *filter, bool connect)
+{
+	auto toggle = connect ? signal_handler_connect : signal_handler_disconnect;
+
+	signal_handler_t *filterHandler = obs_source_get_signal_handler(filter->context);
+	signal_handler_t *globalHandler = obs_get_signal_handler();
+
+	toggle(filterHandler, "enable", vst_filter_enabled, filter);
+	toggle(globalHandler, "source_activate", vst_source_activate, filter);
+	toggle(globalHandler, "source_deactivate", vst_source_deactivate, filter);
+	toggle(globalHandler, "source_rename", vst_source_renamed, filter);
+}
+
 static void vst_destroy(void *data)
 {
-	VSTPlugin *vstPlugin = (VSTPlugin *)data;
-	QMetaObject::invokeMethod(vstPlugin, "closeEditor");
-	vstPlugin->deleteLater();
+	struct vst_filter *filter = (struct vst_filter *)data;
+	vst_connect_signals(filter, false);
+	obs_hotkey_unregister(filter->noteHotkey);
+	obs_hotkey_unregister(filter->sustainHotkey);
+	obs_hotkey_unregister(filter->recorderHotkey);
+
+	governorRemove(&filter->governed);
+
+	obs_source_t *owner = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(filter->stateLock);
+		owner = vst_detach(filter);
+	}
+	if (owner) {
+		obs_source_update(owner, nullptr);
+	}
+	freePlanes(filter->fadePlanes, VST_MAX_CHANNELS);
+	delete filter;
 }
 
 static void vst_update(void *data, obs_data_t *settings)
 {
-	VSTPlugin *vstPlugin = (VSTPlugin *)data;
+	struct vst_filter *filter = (struct vst_filter *)data;
 
-	vstPlugin->openInterfaceWhenActive = obs_data_get_bool(settings, OPEN_WHEN_ACTIVE_VST_SETTINGS);
+	const char *path   = obs_data_get_string(settings, "plugin_path");
+	const char *linkId = obs_data_get_string(settings, LINK_ID_VST_SETTINGS);
+	bool        linked = obs_data_get_bool(settings, LINKED_VST_SETTINGS) && *path;
+
+	// A filter that joins a linked instance keeps its state and plug-in
+	bool applyState = true;
+
+	int priority = (int)obs_data_get_int(settings, SHED_PRIORITY_VST_SETTINGS);
 
-	const char *path = obs_data_get_string(settings, "plugin_path");
+	std::unique_lock<std::mutex> lock(filter->stateLock);
+	if (priority > 0 && !filter->fadePlanes) {
+		float **fadePlanes = allocPlanes(VST_MAX_CHANNELS, GOVERNOR_FADE_CAPACITY);
 
-	if (strcmp(path, "") == 0) {
+		std::lock_guard<std::mutex> swap(filter->pluginLock);
+		filter->fadePlanes = fadePlanes;
+	}
+	filter->governed.priority = priority;
+
+	obs_source_t *owner = nullptr;
+	if (linked != filter->linked || (linked && (filter->linkPath != path || filter->linkId != linkId))) {
+		owner = vst_detach(filter);
+	}
+	VSTPlugin *vstPlugin = filter->plugin;
+	if (!vstPlugin) {
+		vstPlugin = linked ? acquireLinkedInstance(path, linkId, filter->context, applyState)
+		                   : new VSTPlugin(filter->context);
+		{
+			std::lock_guard<std::mutex> swap(filter->pluginLock);
+			filter->linked = linked;
+			filter->plugin = vstPlugin;
+		}
+		filter->linkPath = linked ? path : "";
+		filter->linkId   = linked ? linkId : "";
+		metricsAdd(filter->context, vstPlugin);
+		vst_update_running(filter);
+	} else if (linked) {
+		applyState = false;
+	}
+	vst_check_parent(filter);
+	lock.unlock();
+
+	if (owner) {
+		obs_source_update(owner, nullptr);
+	}
+
+	// A shared instance only takes its options from the filter that owns it
+	if (linked && vstPlugin->getSourceContext() != filter->context) {
+		return;
+	}
+
+	vstPlugin->openInterfaceWhenActive = obs_data_get_bool(settings, OPEN_WHEN_ACTIVE_VST_SETTINGS);
+	vstPlugin->resetOnInvalidOutput    = obs_data_get_bool(settings, RESET_ON_INVALID_VST_SETTINGS);
+	vstPlugin->midiChannel             = (int)obs_data_get_int(settings, MIDI_CHANNEL_VST_SETTINGS) - 1;
+	vstPlugin->midiNote                = (int)obs_data_get_int(settings, MIDI_NOTE_VST_SETTINGS);
+	vstPlugin->midiVelocity            = (int)obs_data_get_int(settings, MIDI_VELOCITY_VST_SETTINGS);
+	vstPlugin->setProcessingOptions((int)obs_data_get_int(settings, OVERSAMPLING_VST_SETTINGS),
+	                                (uint32_t)obs_data_get_int(settings, INTERNAL_RATE_VST_SETTINGS));
+	vstPlugin->setBlockAccumulation((int)obs_data_get_int(settings, ACCUMULATION_VST_SETTINGS));
+	vstPlugin->setStereoPairs(obs_data_get_bool(settings, STEREO_PAIRS_VST_SETTINGS));
+	vstPlugin->setDoublePrecision(obs_data_get_bool(settings, DOUBLE_PRECISION_VST_SETTINGS));
+	vstPlugin->setSidechain(obs_data_get_string(settings, SIDECHAIN_VST_SETTINGS));
+	filter->sidechained = *obs_data_get_string(settings, SIDECHAIN_VST_SETTINGS) != 0;
+	vstPlugin->setRouting(obs_data_get_string(settings, INPUT_ROUTING_VST_SETTINGS),
+	                      obs_data_get_string(settings, OUTPUT_ROUTING_VST_SETTINGS));
+	vstPlugin->setDeadline((int)obs_data_get_int(settings, DEADLINE_BUDGET_VST_SETTINGS),
+	                       (int)obs_data_get_int(settings, DEADLINE_MISSES_VST_SETTINGS));
+	vstPlugin->setSmoothingTime((int)obs_data_get_int(settings, SMOOTHING_VST_SETTINGS));
+	vstPlugin->setFlightRecorder((int)obs_data_get_int(settings, FLIGHT_RECORDER_VST_SETTINGS));
+
+	if (strcmp(path, "") == 0 || !applyState) {
 		return;
 	}
 	vstPlugin->loadEffectFromPath(std::string(path));
 
 	const char *chunkData = obs_data_get_string(settings, "chunk_data");
 	if (chunkData && strlen(chunkData) > 0) {
-		vstPlugin->setChunk(std::string(chunkData));
+		vstPlugin->setChunk(chunkData, strlen(chunkData));
 	}
 }
 
-static void *vst_create(obs_data_t *settings, obs_source_t *filter)
+static void *vst_create(obs_data_t *settings, obs_source_t *source)
 {
-	VSTPlugin *vstPlugin = new VSTPlugin(filter);
-	vst_update(vstPlugin, settings);
+	struct vst_filter *filter = new vst_filter;
+	filter->context           = source;
+	filter->enabled           = obs_source_enabled(source);
+	filter->governed.context  = source;
+	vst_update(filter, settings);
+	vst_connect_signals(filter, true);
+	governorAdd(&filter->governed);
+
+	filter->noteHotkey     = obs_hotkey_register_source(
+	        source, "VSTPlugin.MidiNote", MIDI_NOTE_HOTKEY_TEXT, vst_note_hotkey, filter);
+	filter->sustainHotkey  = obs_hotkey_register_source(
+	        source, "VSTPlugin.MidiSustain", MIDI_SUSTAIN_HOTKEY_TEXT, vst_sustain_hotkey, filter);
+	filter->recorderHotkey = obs_hotkey_register_source(
+	        source, "VSTPlugin.DumpFlightRecorder", FLIGHT_RECORDER_HOTKEY_TEXT, vst_recorder_hotkey, filter);
+
+	return filter;
+}
 
-	return vstPlugin;
+static void vst_defaults(obs_data_t *settings)
+{
+	obs_data_set_default_int(settings, OVERSAMPLING_VST_SETTINGS, 1);
+	obs_data_set_default_int(settings, DEADLINE_MISSES_VST_SETTINGS, 10);
+	obs_data_set_default_int(settings, MIDI_CHANNEL_VST_SETTINGS, 1);
+	obs_data_set_default_int(settings, MIDI_NOTE_VST_SETTINGS, 60);
+	obs_data_set_default_int(settings, MIDI_VELOCITY_VST_SETTINGS, 100);
 }
 
 static void vst_save(void *data, obs_data_t *settings)
 {
-	VSTPlugin *vstPlugin = (VSTPlugin *)data;
+	struct vst_filter *filter = (struct vst_filter *)data;
+
+	// Linked filters all save the state of their shared instance
+	obs_data_set_string(settings, "chunk_data", filter->plugin.load()->getChunk().c_str());
+}
+
+// Runs the plug-in one last or first time and fades from the old to the new
+// state over the start of the packet. Called with pluginLock held.
+static void vst_crossfade(struct vst_filter *filter, struct obs_audio_data *audio, bool toDry)
+{
+	uint32_t frames = audio->frames;
+	if (!filter->fadePlanes || frames > GOVERNOR_FADE_CAPACITY) {
+		if (!toDry) {
+			filter->plugin.load()->process(audio);
+		}
+		return;
+	}
 
-	obs_data_set_string(settings, "chunk_data", vstPlugin->getChunk().c_str());
+	for (size_t c = 0; c < VST_MAX_CHANNELS; c++) {
+		if (audio->data[c]) {
+			memcpy(filter->fadePlanes[c], audio->data[c], frames * sizeof(float));
+		}
+	}
+
+	filter->plugin.load()->process(audio);
+
+	uint32_t fade = frames < GOVERNOR_FADE_FRAMES ? frames : GOVERNOR_FADE_FRAMES;
+	for (size_t c = 0; c < VST_MAX_CHANNELS; c++) {
+		if (!audio->data[c]) {
+			continue;
+		}
+
+		float *      wet = (float *)audio->data[c];
+		const float *dry = filter->fadePlanes[c];
+		for (uint32_t i = 0; i < frames; i++) {
+			// Share of the signal faded to
+			float gain = i < fade ? (float)(i + 1) / fade : 1.0f;
+			wet[i]     = toDry ? wet[i] + (dry[i] - wet[i]) * gain : dry[i] + (wet[i] - dry[i]) * gain;
+		}
+	}
 }
 
 static struct obs_audio_data *vst_filter_audio(void *data, struct obs_audio_data *audio)
 {
-	VSTPlugin *vstPlugin = (VSTPlugin *)data;
-	vstPlugin->process(audio);
+	struct vst_filter *filter = (struct vst_filter *)data;
+
+	RealtimeAuditScope audit(HOST_AUDIT_OWNER);
+	TraceScope         trace("vst_filter_audio");
+
+	// Filters not running pass through, a shared instance only sees the audio of one live filter
+	std::unique_lock<std::mutex> lock(filter->pluginLock, std::try_to_lock);
+	if (!lock.owns_lock()) {
+		return audio;
+	}
+	VSTPlugin *vstPlugin = filter->plugin;
+	if (!vstPlugin || (filter->linked && vstPlugin->liveFilter != filter->context)) {
+		return audio;
+	}
 
-	/*
-	 * OBS can only guarantee getting the filter source's parent and own name
-	 * in this call, so we grab it and return the results for processing
-	 * by the EditorWidget.
-	 */
-	vstPlugin->getSourceNames();
+	// Bypassed filters still move the window on, or nothing would restore them
+	bool shed = filter->governed.shed;
+	if (shed && filter->bypassed) {
+		uint64_t now = os_gettime_ns();
+		governorAccount(&filter->governed, now, now);
+		return audio;
+	}
+
+	uint64_t start = os_gettime_ns();
+	if (shed != filter->bypassed) {
+		vst_crossfade(filter, audio, shed);
+		filter->bypassed = shed;
+	} else {
+		vstPlugin->process(audio);
+	}
+	governorAccount(&filter->governed, start, os_gettime_ns());
 
 	return audio;
 }
 
-static void fill_out_plugins(obs_property_t *list)
+static void vst_tick(void *data, float seconds)
+{
+	UNUSED_PARAMETER(seconds);
+
+	struct vst_filter *filter = (struct vst_filter *)data;
+	if (!filter->parentKnown) {
+		std::lock_guard<std::mutex> lock(filter->stateLock);
+		vst_check_parent(filter);
+	}
+
+	if (!filter->sidechained) {
+		return;
+	}
+
+	// Connects the sidechain once its source shows up. No pluginLock here,
+	// the audio thread would pass packets through while the tick held it;
+	// the sidechain serializes against setSidechain() with its own lock.
+	VSTPlugin *vstPlugin = filter->plugin;
+	if (vstPlugin) {
+		vstPlugin->updateSidechain();
+	}
+}
+
+static bool add_sidechain_source(void *data, obs_source_t *source)
+{
+	obs_property_t *list = (obs_property_t *)data;
+
+	if (obs_source_get_output_flags(source) & OBS_SOURCE_AUDIO) {
+		const char *name = obs_source_get_name(source);
+		obs_property_list_add_string(list, name, name);
+	}
+	return true;
+}
+
+// Every plug-in found, as "name=path"
+static QStringList find_plugins()
 {
 	QStringList dir_list;
 
@@ -224,26 +710,65 @@ static void fill_out_plugins(obs_property_t *list)
 
 	// Now sort list alphabetically (still case-sensitive though).
 	std::stable_sort(vst_list.begin(), vst_list.end(), std::less<QString>());
+	return vst_list;
+}
+
+static void fill_out_plugins(obs_property_t *list)
+{
+	QStringList vst_list    = find_plugins();
+	uint32_t    sample_rate = audio_output_get_sample_rate(obs_get_audio());
 
-	// Now add said list to the plug-in list of OBS
+	// Now add said list to the plug-in list of OBS, profiled ones with their cost
 	obs_property_list_add_string(list, "{Please select a plug-in}", nullptr);
 	for (int b = 0; b < vst_list.size(); ++b) {
-		QString vst_sorted = vst_list[b];
-		obs_property_list_add_string(list,
-		                             vst_sorted.left(vst_sorted.indexOf('=')).toStdString().c_str(),
-		                             vst_sorted.mid(vst_sorted.indexOf('=') + 1).toStdString().c_str());
+		QString     vst_sorted = vst_list[b];
+		std::string name       = vst_sorted.left(vst_sorted.indexOf('=')).toStdString();
+		std::string path       = vst_sorted.mid(vst_sorted.indexOf('=') + 1).toStdString();
+
+		PluginProfile profile;
+		if (profileLookup(path, sample_rate, profile)) {
+			char cost[64];
+			snprintf(cost, sizeof(cost), " (%.0f us, %.1f ms)", profile.usPerBlock, profile.latencyMs);
+			name += cost;
+		}
+		obs_property_list_add_string(list, name.c_str(), path.c_str());
 	}
 }
 
+static bool profile_plugins_clicked(obs_properties_t *props, obs_property_t *property, void *data)
+{
+	UNUSED_PARAMETER(props);
+	UNUSED_PARAMETER(property);
+	UNUSED_PARAMETER(data);
+
+	std::vector<std::string> paths;
+	for (const QString &plugin : find_plugins()) {
+		paths.push_back(plugin.mid(plugin.indexOf('=') + 1).toStdString());
+	}
+
+	// Results show up in the list the next time it is filled
+	audio_t *audio = obs_get_audio();
+	profileAll(paths, audio_output_get_sample_rate(audio), (int)audio_output_get_channels(audio));
+	return false;
+}
+
 static obs_properties_t *vst_properties(void *data)
 {
-	VSTPlugin *       vstPlugin = (VSTPlugin *)data;
-	obs_properties_t *props     = obs_properties_create();
-	obs_property_t *  list      = obs_properties_add_list(
+	struct vst_filter *filter    = (struct vst_filter *)data;
+	VSTPlugin *        vstPlugin = filter->plugin;
+	obs_properties_t * props     = obs_properties_create();
+	obs_property_t *   list      = obs_properties_add_list(
                 props, "plugin_path", PLUG_IN_NAME, OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
 
 	fill_out_plugins(list);
 
+	if (profilerAvailable()) {
+		obs_property_t *profile = obs_properties_add_button(
+		        props, PROFILE_PLUGINS_VST_SETTINGS, PROFILE_PLUGINS_VST_TEXT, profile_plugins_clicked);
+		obs_property_set_long_description(profile, PROFILE_PLUGINS_VST_HELP);
+		obs_property_set_enabled(profile, !profilingRunning());
+	}
+
 	obs_properties_add_button(props, OPEN_VST_SETTINGS, OPEN_VST_TEXT, open_editor_button_clicked);
 	obs_properties_add_button(props, CLOSE_VST_SETTINGS, CLOSE_VST_TEXT, close_editor_button_clicked);
 
@@ -255,6 +780,94 @@ static obs_properties_t *vst_properties(void *data)
 
 	obs_properties_add_bool(props, OPEN_WHEN_ACTIVE_VST_SETTINGS, OPEN_WHEN_ACTIVE_VST_TEXT);
 
+	obs_properties_add_bool(props, LINKED_VST_SETTINGS, LINKED_VST_TEXT);
+	obs_properties_add_text(props, LINK_ID_VST_SETTINGS, LINK_ID_VST_TEXT, OBS_TEXT_DEFAULT);
+
+	obs_property_t *oversampling = obs_properties_add_list(
+	        props, OVERSAMPLING_VST_SETTINGS, OVERSAMPLING_VST_TEXT, OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(oversampling, OVERSAMPLING_NONE_TEXT, 1);
+	obs_property_list_add_int(oversampling, OVERSAMPLING_2X_TEXT, 2);
+	obs_property_list_add_int(oversampling, OVERSAMPLING_4X_TEXT, 4);
+
+	obs_property_t *internalRate = obs_properties_add_list(
+	        props, INTERNAL_RATE_VST_SETTINGS, INTERNAL_RATE_VST_TEXT, OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_list_add_int(internalRate, INTERNAL_RATE_SAME_TEXT, 0);
+	obs_property_list_add_int(internalRate, "44.1 kHz", 44100);
+	obs_property_list_add_int(internalRate, "48 kHz", 48000);
+	obs_property_list_add_int(internalRate, "88.2 kHz", 88200);
+	obs_property_list_add_int(internalRate, "96 kHz", 96000);
+
+	obs_property_t *accumulation = obs_properties_add_list(
+	        props, ACCUMULATION_VST_SETTINGS, ACCUMULATION_VST_TEXT, OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_set_long_description(accumulation, ACCUMULATION_VST_HELP);
+	obs_property_list_add_int(accumulation, ACCUMULATION_NONE_TEXT, 0);
+	obs_property_list_add_int(accumulation, "1024", 1024);
+	obs_property_list_add_int(accumulation, "2048", 2048);
+	obs_property_list_add_int(accumulation, "4096", 4096);
+	obs_property_list_add_int(accumulation, "8192", 8192);
+
+	obs_properties_add_bool(props, STEREO_PAIRS_VST_SETTINGS, STEREO_PAIRS_VST_TEXT);
+	obs_properties_add_bool(props, DOUBLE_PRECISION_VST_SETTINGS, DOUBLE_PRECISION_VST_TEXT);
+
+	obs_property_t *sidechain = obs_properties_add_list(
+	        props, SIDECHAIN_VST_SETTINGS, SIDECHAIN_VST_TEXT, OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_STRING);
+	obs_property_list_add_string(sidechain, SIDECHAIN_NONE_TEXT, "");
+	obs_enum_sources(add_sidechain_source, sidechain);
+
+	obs_property_t *inputRouting =
+	        obs_properties_add_text(props, INPUT_ROUTING_VST_SETTINGS, INPUT_ROUTING_VST_TEXT, OBS_TEXT_DEFAULT);
+	obs_property_set_long_description(inputRouting, INPUT_ROUTING_VST_HELP);
+	obs_property_t *outputRouting =
+	        obs_properties_add_text(props, OUTPUT_ROUTING_VST_SETTINGS, OUTPUT_ROUTING_VST_TEXT, OBS_TEXT_DEFAULT);
+	obs_property_set_long_description(outputRouting, OUTPUT_ROUTING_VST_HELP);
+
+	obs_properties_add_bool(props, RESET_ON_INVALID_VST_SETTINGS, RESET_ON_INVALID_VST_TEXT);
+
+	obs_properties_add_int_slider(props, DEADLINE_BUDGET_VST_SETTINGS, DEADLINE_BUDGET_VST_TEXT, 0, 100, 5);
+	obs_properties_add_int(props, DEADLINE_MISSES_VST_SETTINGS, DEADLINE_MISSES_VST_TEXT, 1, 1000, 1);
+
+	obs_property_t *smoothing = obs_properties_add_int(props, SMOOTHING_VST_SETTINGS, SMOOTHING_VST_TEXT, 0, 200, 5);
+	obs_property_int_set_suffix(smoothing, " ms");
+
+	obs_property_t *recorder = obs_properties_add_int(
+	        props, FLIGHT_RECORDER_VST_SETTINGS, FLIGHT_RECORDER_VST_TEXT, 0, FLIGHT_RECORDER_MAX_SECONDS, 1);
+	obs_property_int_set_suffix(recorder, " s");
+
+	obs_property_t *shedPriority = obs_properties_add_list(
+	        props, SHED_PRIORITY_VST_SETTINGS, SHED_PRIORITY_VST_TEXT, OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
+	obs_property_set_long_description(shedPriority, SHED_PRIORITY_VST_HELP);
+	obs_property_list_add_int(shedPriority, SHED_PRIORITY_NEVER_TEXT, 0);
+	obs_property_list_add_int(shedPriority, SHED_PRIORITY_FIRST_TEXT, 1);
+	obs_property_list_add_int(shedPriority, "2", 2);
+	obs_property_list_add_int(shedPriority, "3", 3);
+	obs_property_list_add_int(shedPriority, "4", 4);
+	obs_property_list_add_int(shedPriority, SHED_PRIORITY_LAST_TEXT, GOVERNOR_MAX_PRIORITY);
+
+	// Used by the MIDI hotkeys
+	obs_properties_add_int(props, MIDI_CHANNEL_VST_SETTINGS, MIDI_CHANNEL_VST_TEXT, 1, 16, 1);
+	obs_properties_add_int(props, MIDI_NOTE_VST_SETTINGS, MIDI_NOTE_VST_TEXT, 0, 127, 1);
+	obs_properties_add_int(props, MIDI_VELOCITY_VST_SETTINGS, MIDI_VELOCITY_VST_TEXT, 1, 127, 1);
+
+	// Runtime data, only ever part of the properties and never of the settings.
+	// It is rebuilt with them, which is all the refresh button does.
+	std::string statisticsText = vstPlugin->getStatistics() + governorStatus(&filter->governed);
+	if (filter->linked) {
+		statisticsText += linkedInstanceStatus(vstPlugin, filter->context);
+	}
+
+	std::string statisticsInfo = std::string(STATISTICS_VST_TEXT) + "\n" + statisticsText;
+#if LIBOBS_API_MAJOR_VER >= 27
+	// An info text shows its description, its value in the settings stays unset
+	obs_properties_add_text(props, STATISTICS_VST_SETTINGS, statisticsInfo.c_str(), OBS_TEXT_INFO);
+	obs_properties_add_button(
+	        props, REFRESH_STATISTICS_VST_SETTINGS, REFRESH_STATISTICS_VST_TEXT, refresh_statistics_clicked);
+#else
+	// Without info texts the refresh button's tooltip carries them
+	obs_property_t *refresh = obs_properties_add_button(
+	        props, REFRESH_STATISTICS_VST_SETTINGS, REFRESH_STATISTICS_VST_TEXT, refresh_statistics_clicked);
+	obs_property_set_long_description(refresh, statisticsInfo.c_str());
+#endif
+
 	return props;
 }
 
@@ -268,10 +881,27 @@ bool obs_module_load(void)
 	vst_filter.create                 = vst_create;
 	vst_filter.destroy                = vst_destroy;
 	vst_filter.update                 = vst_update;
+	vst_filter.get_defaults           = vst_defaults;
 	vst_filter.filter_audio           = vst_filter_audio;
+	vst_filter.video_tick             = vst_tick;
 	vst_filter.get_properties         = vst_properties;
 	vst_filter.save                   = vst_save;
 
 	obs_register_source(&vst_filter);
+	governorInit();
+	metricsInit();
+	profilesLoad();
+	realtimeAuditInit();
+	traceInit();
 	return true;
 }
+
+void obs_module_unload(void)
+{
+#ifdef __linux__
+	EditorThread::get().stop();
+#endif
+	metricsStop();
+	profilesStop();
+	traceWrite();
+}
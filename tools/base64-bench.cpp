@@ -0,0 +1,124 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+/*
+ * Times the chunk_data codec against the QByteArray path getChunk() and
+ * setChunk() used before, on random plug-in states of a few sizes:
+ *
+ *     obs-vst-base64-bench [iterations]
+ *
+ * Both paths are checked to produce the same text and bytes first.
+ */
+
+#include "../headers/Base64.h"
+
+#include <QByteArray>
+#include <QString>
+#include <util/platform.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+static std::string encodeQt(const std::vector<uint8_t> &state)
+{
+	QByteArray data = QByteArray((const char *)state.data(), (int)state.size());
+	return QString(data.toBase64()).toStdString();
+}
+
+static QByteArray decodeQt(const std::string &text)
+{
+	QByteArray base64Data = QByteArray(text.c_str(), (int)text.length());
+	return QByteArray::fromBase64(base64Data);
+}
+
+static std::string encodeDirect(const std::vector<uint8_t> &state)
+{
+	std::string encoded(base64EncodedLength(state.size()), '\0');
+	base64Encode(state.data(), state.size(), &encoded[0]);
+	return encoded;
+}
+
+static std::vector<uint8_t> decodeDirect(const std::string &text)
+{
+	size_t size = 0;
+	if (!base64DecodedLength(text.data(), text.size(), size)) {
+		return {};
+	}
+
+	std::vector<uint8_t> state(size);
+	if (!base64Decode(text.data(), text.size(), state.data())) {
+		return {};
+	}
+	return state;
+}
+
+// Milliseconds per call, the result is kept alive so nothing is optimised away
+template<typename F> static double timeMs(int iterations, F call)
+{
+	size_t   sink  = 0;
+	uint64_t start = os_gettime_ns();
+	for (int i = 0; i < iterations; i++) {
+		sink += call().size();
+	}
+	double elapsed = (os_gettime_ns() - start) / 1e6;
+
+	return sink ? elapsed / iterations : 0.0;
+}
+
+int main(int argc, char **argv)
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : 20;
+	if (iterations <= 0) {
+		fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+		return 1;
+	}
+
+	std::mt19937 random(1);
+	const size_t sizes[] = {4 << 10, 256 << 10, 8 << 20};
+
+	printf("size\tencode Qt ms\tencode ms\tdecode Qt ms\tdecode ms\n");
+
+	for (size_t size : sizes) {
+		std::vector<uint8_t> state(size);
+		for (uint8_t &byte : state) {
+			byte = (uint8_t)random();
+		}
+
+		std::string text = encodeDirect(state);
+		QByteArray  back = decodeQt(text);
+		if (text != encodeQt(state) || decodeDirect(text) != state ||
+		    back != QByteArray((const char *)state.data(), (int)size)) {
+			fprintf(stderr, "%zu bytes: the two codecs disagree\n", size);
+			return 1;
+		}
+
+		// Small states are timed over more calls to get above the clock's noise
+		int calls = size < (1 << 20) ? iterations * 100 : iterations;
+
+		double encodeQtMs     = timeMs(calls, [&] { return encodeQt(state); });
+		double encodeDirectMs = timeMs(calls, [&] { return encodeDirect(state); });
+		double decodeQtMs     = timeMs(calls, [&] { return decodeQt(text); });
+		double decodeDirectMs = timeMs(calls, [&] { return decodeDirect(text); });
+
+		printf("%zu\t%.4f\t%.4f\t%.4f\t%.4f\n", size, encodeQtMs, encodeDirectMs, decodeQtMs, decodeDirectMs);
+	}
+
+	return 0;
+}
@@ -0,0 +1,105 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+/*
+ * libFuzzer target for malformed chunk_data. Every input goes through the
+ * same steps as setChunk(): the length check, then decoding into a buffer
+ * of exactly the announced size. The result is compared with a plain scalar
+ * decoder, and whatever decodes has to survive an encode/decode round trip.
+ *
+ *     obs-vst-base64-fuzz -max_len=4096 corpus/
+ */
+
+#include "../headers/Base64.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// The rules from Base64.h, one character at a time
+static bool decodeReference(const char *text, size_t length, std::vector<uint8_t> &out)
+{
+	while (length && (text[length - 1] == ' ' || text[length - 1] == '\t' || text[length - 1] == '\r' ||
+	                  text[length - 1] == '\n')) {
+		length--;
+	}
+
+	size_t padding = 0;
+	while (padding < 2 && length > padding && text[length - 1 - padding] == '=') {
+		padding++;
+	}
+
+	size_t characters = length - padding;
+	if (characters % 4 == 1 || (padding && length % 4)) {
+		return false;
+	}
+
+	uint32_t value = 0;
+	int      bits  = 0;
+	out.clear();
+	for (size_t i = 0; i < characters; i++) {
+		const char *found = text[i] ? strchr(alphabet, text[i]) : nullptr;
+		if (!found) {
+			return false;
+		}
+
+		value = value << 6 | (uint32_t)(found - alphabet);
+		bits += 6;
+		if (bits >= 8) {
+			bits -= 8;
+			out.push_back((uint8_t)(value >> bits));
+		}
+	}
+	return true;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	const char *text = (const char *)data;
+
+	std::vector<uint8_t> expected;
+	bool                 valid = decodeReference(text, size, expected);
+
+	// Exactly sized like setChunk() does, so any overrun trips ASan
+	std::vector<uint8_t> state;
+	size_t               decodedSize = 0;
+	bool                 decoded     = false;
+	if (base64DecodedLength(text, size, decodedSize)) {
+		state.resize(decodedSize);
+		decoded = base64Decode(text, size, state.data());
+	}
+
+	if (decoded != valid || (valid && state != expected)) {
+		abort();
+	}
+	if (!decoded) {
+		return 0;
+	}
+
+	std::string encoded(base64EncodedLength(state.size()), '\0');
+	base64Encode(state.data(), state.size(), &encoded[0]);
+
+	std::vector<uint8_t> again;
+	if (!decodeReference(encoded.data(), encoded.size(), again) || again != state) {
+		abort();
+	}
+	return 0;
+}
@@ -0,0 +1,150 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+/*
+ * Times the host loop of VSTPlugin::process() around obs-vst-passthrough,
+ * a plug-in that only copies its inputs, for the common plane layouts in
+ * packets of whole blocks and with a shorter tail. VST_BUILD_BENCHMARKS
+ * builds it twice: obs-vst-host-bench with the specialised kernels and
+ * obs-vst-host-bench-generic with VST_GENERIC_PACKET_KERNEL, where every
+ * layout takes the generic loop as before them. Run both and compare.
+ * The last cases time the oversampler and the rate converter around the
+ * same plug-in, so their cost shows next to the plain host loop:
+ *
+ *     obs-vst-host-bench [path to obs-vst-passthrough] [packets]
+ */
+
+#include "../headers/VSTPlugin.h"
+#include "render-host.h"
+
+#include <util/platform.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define BENCH_RATE 48000
+#define BENCH_WARMUP_PACKETS 1000
+
+struct BenchCase {
+	const char *name;
+	uint32_t    planes;
+	uint32_t    frames;
+	// Passed to setProcessingOptions(), 1 and 0 process at the host rate
+	int      oversampling;
+	uint32_t internalRate;
+};
+
+static const BenchCase benchCases[] = {
+        {"mono", 0x01, 1024, 1, 0},
+        {"mono", 0x01, 480, 1, 0},
+        {"stereo", 0x03, 1024, 1, 0},
+        {"stereo", 0x03, 480, 1, 0},
+        {"5.1", 0x3f, 1024, 1, 0},
+        {"5.1", 0x3f, 480, 1, 0},
+        {"7.1", 0xff, 1024, 1, 0},
+        {"7.1", 0xff, 480, 1, 0},
+        {"planes 0+2", 0x05, 1024, 1, 0},
+        {"stereo 2x", 0x03, 1024, 2, 0},
+        {"stereo 4x", 0x03, 1024, 4, 0},
+        {"stereo at 44.1 kHz", 0x03, 1024, 1, 44100},
+        {"stereo at 96 kHz", 0x03, 1024, 1, 96000},
+        {"stereo 2x at 44.1 kHz", 0x03, 1024, 2, 44100},
+};
+
+static void benchLogHandler(int level, const char *format, va_list args, void *param)
+{
+	UNUSED_PARAMETER(param);
+
+	if (level > LOG_WARNING) {
+		return;
+	}
+
+	vfprintf(stderr, format, args);
+	fputc('\n', stderr);
+}
+
+// Nanoseconds per block of BLOCK_SIZE frames, negative if the plug-in failed to load
+static double benchCase(const char *path, const BenchCase &bench, int packets)
+{
+	int channels = 0;
+	for (int c = 0; c < VST_MAX_CHANNELS; c++) {
+		channels = bench.planes & (1u << c) ? c + 1 : channels;
+	}
+	RenderHost host(BENCH_RATE, channels, "obs-vst-host-bench");
+	VSTPlugin *plugin = new VSTPlugin(nullptr, &host);
+	plugin->loadEffectFromPath(path);
+	plugin->setProcessingOptions(bench.oversampling, bench.internalRate);
+
+	double result = -1.0;
+	if (plugin->isEffectReady()) {
+		std::vector<std::vector<float>> buffers(VST_MAX_CHANNELS, std::vector<float>(bench.frames, 0.25f));
+		struct obs_audio_data           audio = {};
+		for (int c = 0; c < VST_MAX_CHANNELS; c++) {
+			if (bench.planes & (1u << c)) {
+				audio.data[c] = (uint8_t *)buffers[c].data();
+			}
+		}
+		audio.frames = bench.frames;
+
+		uint64_t start = 0;
+		for (int packet = 0; packet < BENCH_WARMUP_PACKETS + packets; packet++) {
+			if (packet == BENCH_WARMUP_PACKETS) {
+				start = os_gettime_ns();
+			}
+			audio.timestamp = (uint64_t)packet * bench.frames * 1000000000ULL / BENCH_RATE;
+			plugin->process(&audio);
+		}
+
+		uint64_t blocks = (uint64_t)packets * ((bench.frames + BLOCK_SIZE - 1) / BLOCK_SIZE);
+		result          = (double)(os_gettime_ns() - start) / blocks;
+	}
+
+	delete plugin;
+	return result;
+}
+
+int main(int argc, char **argv)
+{
+	const char *path    = argc > 1 ? argv[1] : OBS_VST_PASSTHROUGH_PATH;
+	int         packets = argc > 2 ? atoi(argv[2]) : 200000;
+	if (packets <= 0) {
+		fprintf(stderr, "usage: %s [path to obs-vst-passthrough] [packets]\n", argv[0]);
+		return 1;
+	}
+
+	base_set_log_handler(benchLogHandler, nullptr);
+
+#ifdef VST_GENERIC_PACKET_KERNEL
+	printf("generic kernel\n");
+#else
+	printf("specialised kernels\n");
+#endif
+	printf("layout\tframes\tns per block\n");
+
+	for (const BenchCase &bench : benchCases) {
+		double time = benchCase(path, bench, packets);
+		if (time < 0.0) {
+			fprintf(stderr, "%s: could not load plug-in\n", path);
+			return 1;
+		}
+		printf("%s\t%u\t%.1f\n", bench.name, bench.frames, time);
+	}
+
+	return 0;
+}
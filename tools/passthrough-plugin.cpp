@@ -0,0 +1,104 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+/*
+ * A VST 2 effect that copies its inputs to its outputs and does nothing else,
+ * for timing what the host costs around a plug-in. Built with
+ * VST_BUILD_BENCHMARKS, see tools/host-bench.cpp.
+ */
+
+#include "aeffectx.h"
+
+#include <string.h>
+
+#define PASSTHROUGH_CHANNELS 8
+
+#if defined(_WIN32)
+#define PASSTHROUGH_EXPORT extern "C" __declspec(dllexport)
+#else
+#define PASSTHROUGH_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+static intptr_t passthroughDispatcher(AEffect *effect, int opcode, int index, intptr_t value, void *ptr, float opt)
+{
+	(void)index;
+	(void)value;
+	(void)opt;
+
+	switch (opcode) {
+	case effClose:
+		delete effect;
+		return 0;
+
+	case effGetEffectName:
+		strcpy((char *)ptr, "Passthrough");
+		return 1;
+
+	case effGetVendorString:
+		strcpy((char *)ptr, "obs-vst");
+		return 1;
+
+	case effSetSpeakerArrangement:
+		return 1;
+	}
+	return 0;
+}
+
+static void passthroughProcess(AEffect *effect, float **inputs, float **outputs, int frames)
+{
+	(void)effect;
+
+	for (int c = 0; c < PASSTHROUGH_CHANNELS; c++) {
+		if (inputs[c] != outputs[c]) {
+			memcpy(outputs[c], inputs[c], frames * sizeof(float));
+		}
+	}
+}
+
+static void passthroughSetParameter(AEffect *effect, int index, float value)
+{
+	(void)effect;
+	(void)index;
+	(void)value;
+}
+
+static float passthroughGetParameter(AEffect *effect, int index)
+{
+	(void)effect;
+	(void)index;
+	return 0.0f;
+}
+
+PASSTHROUGH_EXPORT AEffect *VSTPluginMain(audioMasterCallback host)
+{
+	(void)host;
+
+	AEffect *effect          = new AEffect();
+	effect->magic            = kEffectMagic;
+	effect->dispatcher       = passthroughDispatcher;
+	effect->process          = passthroughProcess;
+	effect->setParameter     = passthroughSetParameter;
+	effect->getParameter     = passthroughGetParameter;
+	effect->numInputs        = PASSTHROUGH_CHANNELS;
+	effect->numOutputs       = PASSTHROUGH_CHANNELS;
+	effect->flags            = effFlagsCanReplacing;
+	effect->uniqueID         = 0x6f767074;
+	effect->version          = 1;
+	effect->processReplacing = passthroughProcess;
+	return effect;
+}
@@ -0,0 +1,39 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#include "render-host.h"
+
+// No module is loaded, but the engine's obs_module_* calls need the symbols
+OBS_DECLARE_MODULE()
+
+RenderHost::RenderHost(uint32_t sampleRate, int channels, const char *name)
+        : sampleRate(sampleRate), channels(channels), name(name)
+{
+}
+
+const char *RenderHost::getFilterName(obs_source_t *filter)
+{
+	UNUSED_PARAMETER(filter);
+	return name.c_str();
+}
+
+const char *RenderHost::getTargetName(obs_source_t *filter)
+{
+	UNUSED_PARAMETER(filter);
+	return nullptr;
+}
@@ -0,0 +1,46 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+
+#ifndef OBS_STUDIO_RENDER_HOST_H
+#define OBS_STUDIO_RENDER_HOST_H
+
+#include "../headers/VSTHost.h"
+
+#include <string>
+
+/*
+ * The host of a VSTPlugin driven outside of OBS: a fixed audio format and
+ * a name for the editor title. libobs is still linked for its utility
+ * functions, but obs_startup() is never called.
+ */
+class RenderHost : public VSTHost {
+	uint32_t    sampleRate;
+	int         channels;
+	std::string name;
+
+public:
+	RenderHost(uint32_t sampleRate, int channels, const char *name);
+
+	uint32_t getSampleRate() override { return sampleRate; }
+	int      getChannels() override { return channels; }
+
+	const char *getFilterName(obs_source_t *filter) override;
+	const char *getTargetName(obs_source_t *filter) override;
+};
+
+#endif // OBS_STUDIO_RENDER_HOST_H
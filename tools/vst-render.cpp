@@ -0,0 +1,586 @@
+/*****************************************************************************
+Copyright (C) 2016-2017 by Colin Edwards.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*****************************************************************************/
+
+/*
+ * Renders WAV files through a chain of VST plug-ins with the same engine the
+ * OBS filter uses, as fast as the plug-ins allow. Files are spread over
+ * worker threads, each of which owns its own instance of every plug-in in
+ * the chain. Plug-in state comes from the chunk_data of a filter, either
+ * given directly or as the filter's settings JSON copied from a scene
+ * collection. Also serves as a throughput benchmark of the host path.
+ */
+
+#include "../headers/VSTPlugin.h"
+#include "../headers/WavFile.h"
+#include "render-host.h"
+
+#include <util/platform.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#define RENDER_BLOCK_FRAMES 1024
+#define PROFILE_WARMUP_SECONDS 1
+#define PROFILE_SECONDS 5
+
+struct ChainEntry {
+	std::string path;
+	std::string chunk;
+	int         oversampling = 1;
+	uint32_t    internalRate = 0;
+	int         smoothing    = 0;
+	int         accumulation = 0;
+	bool        stereoPairs  = false;
+	bool        doubleFloat  = false;
+	std::string inputRouting;
+	std::string outputRouting;
+};
+
+struct RenderOptions {
+	std::vector<ChainEntry>  chain;
+	std::vector<std::string> inputs;
+	std::string              outputDir;
+	int                      jobs     = 0;
+	int                      block    = RENDER_BLOCK_FRAMES;
+	double                   tail     = 0.0;
+	bool                     verbose  = false;
+	bool                     profile  = false;
+	uint32_t                 rate     = 48000;
+	int                      channels = 2;
+};
+
+struct RenderTotals {
+	std::mutex lock;
+	double     audioSeconds  = 0.0;
+	double     renderSeconds = 0.0;
+	int        failed        = 0;
+};
+
+static bool verboseLog = false;
+
+static void renderLogHandler(int level, const char *format, va_list args, void *param)
+{
+	UNUSED_PARAMETER(param);
+
+	if (level > LOG_WARNING && !verboseLog) {
+		return;
+	}
+
+	vfprintf(stderr, format, args);
+	fputc('\n', stderr);
+}
+
+static void printUsage(const char *program)
+{
+	fprintf(stderr,
+	        "Usage: %s [options] -o <directory> <input.wav>...\n"
+	        "\n"
+	        "Plug-in chain, in processing order:\n"
+	        "  -p, --plugin <path>         add a plug-in\n"
+	        "  -s, --settings <file.json>  add a plug-in from a VST filter's settings\n"
+	        "  -c, --chunk <data>          chunk_data for the last plug-in\n"
+	        "  -C, --chunk-file <path>     chunk_data for the last plug-in, read from a file\n"
+	        "      --oversampling <1|2|4>  oversampling of the last plug-in\n"
+	        "      --internal-rate <hz>    internal sample rate of the last plug-in\n"
+	        "      --smoothing <ms>        parameter smoothing of the last plug-in\n"
+	        "      --accumulate <frames>   run the last plug-in on blocks of this size\n"
+	        "      --stereo-pairs          split the last plug-in into stereo pairs\n"
+	        "      --double                process the last plug-in in 64-bit if it can\n"
+	        "\n"
+	        "Rendering:\n"
+	        "  -o, --output <directory>    where rendered files are written\n"
+	        "  -j, --jobs <n>              worker threads (default: one per core)\n"
+	        "  -b, --block <frames>        frames per filter call (default: %d, as OBS)\n"
+	        "  -t, --tail <seconds>        silence appended to let effects ring out\n"
+	        "  -v, --verbose               log plug-in loading\n"
+	        "\n"
+	        "Profiling, instead of rendering files:\n"
+	        "      --profile               time every plug-in on %d s of noise and print its\n"
+	        "                              path, us per block of %d frames and latency in ms,\n"
+	        "                              tab separated\n"
+	        "      --rate <hz>             sample rate to profile at (default: 48000)\n"
+	        "      --channels <n>          channels to profile with (default: 2)\n",
+	        program,
+	        RENDER_BLOCK_FRAMES,
+	        PROFILE_SECONDS,
+	        BLOCK_SIZE);
+}
+
+static bool loadSettings(const char *path, ChainEntry &entry)
+{
+	obs_data_t *settings = obs_data_create_from_json_file(path);
+	if (!settings) {
+		fprintf(stderr, "Could not read settings from '%s'\n", path);
+		return false;
+	}
+
+	// A whole filter object from a scene collection nests them
+	obs_data_t *nested = obs_data_get_obj(settings, "settings");
+	obs_data_t *filter = nested ? nested : settings;
+
+	entry.path          = obs_data_get_string(filter, "plugin_path");
+	entry.chunk         = obs_data_get_string(filter, "chunk_data");
+	entry.internalRate  = (uint32_t)obs_data_get_int(filter, "internal_sample_rate");
+	entry.smoothing     = (int)obs_data_get_int(filter, "parameter_smoothing");
+	entry.accumulation  = (int)obs_data_get_int(filter, "accumulation_frames");
+	entry.stereoPairs   = obs_data_get_bool(filter, "stereo_pairs");
+	entry.doubleFloat   = obs_data_get_bool(filter, "double_precision");
+	entry.inputRouting  = obs_data_get_string(filter, "input_routing");
+	entry.outputRouting = obs_data_get_string(filter, "output_routing");
+	if (obs_data_has_user_value(filter, "oversampling")) {
+		entry.oversampling = (int)obs_data_get_int(filter, "oversampling");
+	}
+
+	obs_data_release(nested);
+	obs_data_release(settings);
+
+	if (entry.path.empty()) {
+		fprintf(stderr, "No plugin_path in '%s'\n", path);
+		return false;
+	}
+	return true;
+}
+
+static bool parseArguments(int argc, char **argv, RenderOptions &options)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg.empty()) {
+			continue;
+		}
+
+		const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+
+		auto is = [&](const char *shortName, const char *longName) {
+			return (shortName && arg == shortName) || arg == longName;
+		};
+		bool needsValue = arg.size() > 1 && arg[0] == '-' && !is("-v", "--verbose") && !is("-h", "--help") &&
+		                  !is(nullptr, "--stereo-pairs") && !is(nullptr, "--double") && !is(nullptr, "--profile");
+
+		if (needsValue && !value) {
+			fprintf(stderr, "Missing value for %s\n", arg.c_str());
+			return false;
+		}
+		if (!needsValue && arg[0] != '-') {
+			options.inputs.push_back(arg);
+			continue;
+		}
+
+		bool needsPlugin = is("-c", "--chunk") || is("-C", "--chunk-file") || is(nullptr, "--oversampling") ||
+		                   is(nullptr, "--internal-rate") || is(nullptr, "--smoothing") ||
+		                   is(nullptr, "--accumulate") || is(nullptr, "--stereo-pairs") ||
+		                   is(nullptr, "--double");
+		if (needsPlugin && options.chain.empty()) {
+			fprintf(stderr, "%s must follow a plug-in\n", arg.c_str());
+			return false;
+		}
+
+		if (is("-h", "--help")) {
+			return false;
+		} else if (is("-v", "--verbose")) {
+			options.verbose = true;
+			continue;
+		} else if (is(nullptr, "--stereo-pairs")) {
+			options.chain.back().stereoPairs = true;
+			continue;
+		} else if (is(nullptr, "--double")) {
+			options.chain.back().doubleFloat = true;
+			continue;
+		} else if (is(nullptr, "--profile")) {
+			options.profile = true;
+			continue;
+		} else if (is("-p", "--plugin")) {
+			ChainEntry entry;
+			entry.path = value;
+			options.chain.push_back(entry);
+		} else if (is("-s", "--settings")) {
+			ChainEntry entry;
+			if (!loadSettings(value, entry)) {
+				return false;
+			}
+			options.chain.push_back(entry);
+		} else if (is("-c", "--chunk")) {
+			options.chain.back().chunk = value;
+		} else if (is("-C", "--chunk-file")) {
+			char *chunk = os_quick_read_utf8_file(value);
+			if (!chunk) {
+				fprintf(stderr, "Could not read '%s'\n", value);
+				return false;
+			}
+			// Trailing newlines from editors are not part of the base64
+			std::string &target = options.chain.back().chunk;
+			target              = chunk;
+			target.erase(target.find_last_not_of(" \t\r\n") + 1);
+			bfree(chunk);
+		} else if (is(nullptr, "--oversampling")) {
+			options.chain.back().oversampling = atoi(value);
+		} else if (is(nullptr, "--internal-rate")) {
+			options.chain.back().internalRate = (uint32_t)atoi(value);
+		} else if (is(nullptr, "--smoothing")) {
+			options.chain.back().smoothing = atoi(value);
+		} else if (is(nullptr, "--accumulate")) {
+			options.chain.back().accumulation = atoi(value);
+		} else if (is("-o", "--output")) {
+			options.outputDir = value;
+		} else if (is("-j", "--jobs")) {
+			options.jobs = atoi(value);
+		} else if (is("-b", "--block")) {
+			options.block = atoi(value);
+		} else if (is("-t", "--tail")) {
+			options.tail = atof(value);
+		} else if (is(nullptr, "--rate")) {
+			options.rate = (uint32_t)atoi(value);
+		} else if (is(nullptr, "--channels")) {
+			options.channels = atoi(value);
+		} else {
+			fprintf(stderr, "Unknown option %s\n", arg.c_str());
+			return false;
+		}
+		i++;
+	}
+
+	if (options.chain.empty()) {
+		return false;
+	}
+	if (options.profile) {
+		return options.rate > 0 && options.channels > 0 && options.channels <= VST_MAX_CHANNELS;
+	}
+	if (options.inputs.empty() || options.outputDir.empty()) {
+		return false;
+	}
+	if (options.block <= 0) {
+		options.block = RENDER_BLOCK_FRAMES;
+	}
+	return true;
+}
+
+static std::string outputPath(const RenderOptions &options, const std::string &input)
+{
+	size_t slash = input.find_last_of("/\\");
+	return options.outputDir + "/" + (slash == std::string::npos ? input : input.substr(slash + 1));
+}
+
+/*
+ * One worker's instances of the chain. They are created for the sample rate
+ * and channel count of the file at hand and only rebuilt when a file with
+ * another format comes along, as plug-ins size their buffers, routing and
+ * stereo pairs for it; between files they are suspended and resumed to clear
+ * their state.
+ */
+class RenderChain {
+
+	const RenderOptions &       options;
+	std::vector<VSTPlugin *>  plugins;
+	std::vector<RenderHost *> hosts;
+	uint32_t                  sampleRate   = 0;
+	int                       channelCount = 0;
+
+public:
+	explicit RenderChain(const RenderOptions &options) : options(options) {}
+	~RenderChain() { destroy(); }
+
+	void destroy()
+	{
+		for (VSTPlugin *plugin : plugins) {
+			delete plugin;
+		}
+		for (RenderHost *host : hosts) {
+			delete host;
+		}
+		plugins.clear();
+		hosts.clear();
+		sampleRate   = 0;
+		channelCount = 0;
+	}
+
+	// Returns false if a plug-in could not be loaded
+	bool prepare(uint32_t rate, int channels)
+	{
+		if (rate == sampleRate && channels == channelCount) {
+			for (VSTPlugin *plugin : plugins) {
+				plugin->setEnabled(false);
+				plugin->setEnabled(true);
+			}
+			return true;
+		}
+
+		destroy();
+		sampleRate   = rate;
+		channelCount = channels;
+
+		for (const ChainEntry &entry : options.chain) {
+			RenderHost *host   = new RenderHost(rate, channels, entry.path.c_str());
+			VSTPlugin * plugin = new VSTPlugin(nullptr, host);
+
+			// Same order as vst_update
+			plugin->setProcessingOptions(entry.oversampling, entry.internalRate);
+			plugin->setBlockAccumulation(entry.accumulation);
+			plugin->setSmoothingTime(entry.smoothing);
+			plugin->setStereoPairs(entry.stereoPairs);
+			plugin->setDoublePrecision(entry.doubleFloat);
+			plugin->setRouting(entry.inputRouting.c_str(), entry.outputRouting.c_str());
+			plugin->loadEffectFromPath(entry.path);
+			if (!entry.chunk.empty()) {
+				plugin->setChunk(entry.chunk.data(), entry.chunk.size());
+			}
+
+			hosts.push_back(host);
+			plugins.push_back(plugin);
+
+			if (!plugin->isEffectReady()) {
+				fprintf(stderr, "%s: could not load plug-in\n", entry.path.c_str());
+				destroy();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void process(struct obs_audio_data *audio)
+	{
+		for (VSTPlugin *plugin : plugins) {
+			plugin->process(audio);
+		}
+	}
+
+	// In frames at the rate the chain was prepared for
+	double getLatency()
+	{
+		double latency = 0.0;
+		for (VSTPlugin *plugin : plugins) {
+			latency += plugin->getLatency();
+		}
+		return latency;
+	}
+};
+
+static bool renderFile(RenderChain &chain, const RenderOptions &options, const std::string &input, double &seconds)
+{
+	WavReader reader;
+	if (!reader.open(input.c_str())) {
+		fprintf(stderr, "%s: not a supported WAV file\n", input.c_str());
+		return false;
+	}
+
+	int channels = reader.getChannels();
+	if (channels > VST_MAX_CHANNELS) {
+		fprintf(stderr, "%s: more than %d channels\n", input.c_str(), VST_MAX_CHANNELS);
+		return false;
+	}
+
+	if (!chain.prepare(reader.getSampleRate(), channels)) {
+		return false;
+	}
+
+	std::string output = outputPath(options, input);
+	WavWriter   writer;
+	if (!writer.open(output.c_str(), channels, reader.getSampleRate())) {
+		fprintf(stderr, "%s: could not create\n", output.c_str());
+		return false;
+	}
+
+
+	std::vector<std::vector<float>> buffers(channels, std::vector<float>(options.block));
+	struct obs_audio_data           audio = {};
+	for (int channel = 0; channel < channels; channel++) {
+		audio.data[channel] = (uint8_t *)buffers[channel].data();
+	}
+
+	uint64_t tailFrames = (uint64_t)(options.tail * reader.getSampleRate());
+	uint64_t position   = 0;
+	bool     success    = true;
+
+	for (;;) {
+		int frames = reader.read((float *const *)audio.data, options.block);
+		if (frames < options.block && tailFrames) {
+			int silence = (int)std::min<uint64_t>(tailFrames, (uint64_t)(options.block - frames));
+			for (int channel = 0; channel < channels; channel++) {
+				memset(buffers[channel].data() + frames, 0, silence * sizeof(float));
+			}
+			frames += silence;
+			tailFrames -= silence;
+		}
+		if (!frames) {
+			break;
+		}
+
+		audio.frames    = (uint32_t)frames;
+		audio.timestamp = position * 1000000000ULL / reader.getSampleRate();
+		chain.process(&audio);
+
+		if (!writer.write((const float *const *)audio.data, frames)) {
+			success = false;
+			break;
+		}
+		position += frames;
+	}
+
+	success &= writer.close();
+	if (!success) {
+		fprintf(stderr, "%s: write failed\n", output.c_str());
+	}
+
+	seconds = (double)position / reader.getSampleRate();
+	return success;
+}
+
+static void renderWorker(const RenderOptions &options, std::atomic<size_t> &next, RenderTotals &totals)
+{
+	RenderChain chain(options);
+
+	for (size_t index = next++; index < options.inputs.size(); index = next++) {
+		const std::string &input = options.inputs[index];
+
+		uint64_t start   = os_gettime_ns();
+		double   seconds = 0.0;
+		bool     success = renderFile(chain, options, input, seconds);
+		double   elapsed = (os_gettime_ns() - start) / 1e9;
+
+		std::lock_guard<std::mutex> lock(totals.lock);
+		if (!success) {
+			totals.failed++;
+			continue;
+		}
+
+		totals.audioSeconds += seconds;
+		totals.renderSeconds += elapsed;
+		printf("%s: %.2f s of audio in %.2f s (%.1fx real time)\n",
+		       input.c_str(),
+		       seconds,
+		       elapsed,
+		       elapsed > 0.0 ? seconds / elapsed : 0.0);
+	}
+}
+
+/*
+ * Times one plug-in on its own, fed white noise in packets the size OBS
+ * uses. The first second is not counted, plug-ins often allocate or build
+ * tables on their first blocks.
+ */
+static bool profilePlugin(const RenderOptions &options, const ChainEntry &entry)
+{
+	RenderOptions single = options;
+	single.chain.assign(1, entry);
+
+	RenderChain chain(single);
+	if (!chain.prepare(options.rate, options.channels)) {
+		return false;
+	}
+
+	std::vector<std::vector<float>> buffers(options.channels, std::vector<float>(options.block));
+	struct obs_audio_data           audio = {};
+	for (int channel = 0; channel < options.channels; channel++) {
+		audio.data[channel] = (uint8_t *)buffers[channel].data();
+	}
+	audio.frames = (uint32_t)options.block;
+
+	uint64_t total    = (uint64_t)(PROFILE_WARMUP_SECONDS + PROFILE_SECONDS) * options.rate;
+	uint64_t warmup   = (uint64_t)PROFILE_WARMUP_SECONDS * options.rate;
+	uint64_t position = 0;
+	uint64_t elapsed  = 0;
+	uint32_t noise    = 0x12345678;
+
+	while (position < total) {
+		// The plug-in works in place, so the input is generated every time
+		for (int channel = 0; channel < options.channels; channel++) {
+			for (int frame = 0; frame < options.block; frame++) {
+				noise ^= noise << 13;
+				noise ^= noise >> 17;
+				noise ^= noise << 5;
+				buffers[channel][frame] = (float)((int32_t)noise * (0.25 / 2147483648.0));
+			}
+		}
+
+		audio.timestamp = position * 1000000000ULL / options.rate;
+		uint64_t start  = os_gettime_ns();
+		chain.process(&audio);
+		if (position >= warmup) {
+			elapsed += os_gettime_ns() - start;
+		}
+		position += options.block;
+	}
+
+	double blocks = (double)(position - warmup) / BLOCK_SIZE;
+	printf("%s\t%.2f\t%.3f\n",
+	       entry.path.c_str(),
+	       elapsed / 1000.0 / blocks,
+	       chain.getLatency() * 1000.0 / options.rate);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	RenderOptions options;
+	if (!parseArguments(argc, argv, options)) {
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	verboseLog = options.verbose;
+	base_set_log_handler(renderLogHandler, nullptr);
+
+	if (options.profile) {
+		int failed = 0;
+		for (const ChainEntry &entry : options.chain) {
+			failed += profilePlugin(options, entry) ? 0 : 1;
+		}
+		return failed ? 1 : 0;
+	}
+
+	if (os_mkdirs(options.outputDir.c_str()) == MKDIR_ERROR) {
+		fprintf(stderr, "Could not create '%s'\n", options.outputDir.c_str());
+		return 1;
+	}
+
+	int jobs = options.jobs > 0 ? options.jobs : (int)std::thread::hardware_concurrency();
+	jobs     = std::max(1, std::min(jobs, (int)options.inputs.size()));
+
+	traceInit();
+
+	std::atomic<size_t>      next{0};
+	RenderTotals             totals;
+	std::vector<std::thread> workers;
+	uint64_t                 start = os_gettime_ns();
+
+	for (int i = 0; i < jobs; i++) {
+		workers.emplace_back(renderWorker, std::cref(options), std::ref(next), std::ref(totals));
+	}
+	for (std::thread &worker : workers) {
+		worker.join();
+	}
+
+	double elapsed = (os_gettime_ns() - start) / 1e9;
+
+	traceWrite();
+
+	printf("%d file(s), %.2f s of audio in %.2f s with %d worker(s): %.1fx real time overall, "
+	       "%.1fx per worker\n",
+	       (int)options.inputs.size() - totals.failed,
+	       totals.audioSeconds,
+	       elapsed,
+	       jobs,
+	       elapsed > 0.0 ? totals.audioSeconds / elapsed : 0.0,
+	       totals.renderSeconds > 0.0 ? totals.audioSeconds / totals.renderSeconds : 0.0);
+
+	return totals.failed ? 1 : 0;
+}
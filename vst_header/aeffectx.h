@@ -89,6 +89,8 @@ const int effFlagsHasEditor = 1;
 const int effFlagsCanReplacing = 1 << 4; // very likely
 const int effFlagsProgramChunks = 1 << 5; // from Ardour
 const int effFlagsIsSynth = 1 << 8; // currently unused
+// The next one was gleaned from http://www.asseca.org/vst-24-specs/efFlags.html
+const int effFlagsCanDoubleReplacing = 1 << 12;
 
 const int effOpen = 0;
 const int effClose = 1; // currently unused
@@ -119,6 +121,8 @@ const int effCanBeAutomated = 26;
 const int effGetProgramNameIndexed = 29;
 // The next one was gleaned from http://www.asseca.org/vst-24-specs/efGetPlugCategory.html
 const int effGetPlugCategory = 35;
+// The next one was gleaned from http://www.asseca.org/vst-24-specs/efSetSpeakerArrangement.html
+const int effSetSpeakerArrangement = 42;
 const int effGetEffectName = 45;
 const int effGetParameterProperties = 56; // missing
 const int effGetVendorString = 47;
@@ -132,12 +136,19 @@ const int effGetVstVersion = 58; // currently unused
 const int effBeginSetProgram = 67;
 // The next one was gleaned from http://www.asseca.org/vst-24-specs/efEndSetProgram.html
 const int effEndSetProgram = 68;
+// The next one was gleaned from http://www.asseca.org/vst-24-specs/efGetSpeakerArrangement.html
+const int effGetSpeakerArrangement = 69;
 // The next one was gleaned from http://www.asseca.org/vst-24-specs/efShellGetNextPlugin.html
 const int effShellGetNextPlugin = 70;
 // The next one was gleaned from http://www.asseca.org/vst-24-specs/efBeginLoadBank.html
 const int effBeginLoadBank = 75;
 // The next one was gleaned from http://www.asseca.org/vst-24-specs/efBeginLoadProgram.html
 const int  effBeginLoadProgram = 76;
+// The next one was gleaned from http://www.asseca.org/vst-24-specs/efSetProcessPrecision.html
+const int effSetProcessPrecision = 77;
+
+const int kVstProcessPrecision32 = 0;
+const int kVstProcessPrecision64 = 1;
 
 // The next two were gleaned from http://www.kvraudio.com/forum/printview.php?t=143587&start=0
 const int effStartProcess = 71;
@@ -162,6 +173,20 @@ const int kVstTransportPlaying = 1 << 1;
 const int kVstTransportCycleActive = 1 << 2;
 const int kVstTransportChanged = 1;
 
+// from http://www.asseca.org/vst-24-specs/amGetCurrentProcessLevel.html
+const int kVstProcessLevelUnknown = 0;
+const int kVstProcessLevelUser = 1;
+const int kVstProcessLevelRealtime = 2;
+const int kVstProcessLevelPrefetch = 3;
+const int kVstProcessLevelOffline = 4;
+
+// from http://www.asseca.org/vst-24-specs/amGetAutomationState.html
+const int kVstAutomationUnsupported = 0;
+const int kVstAutomationOff = 1;
+const int kVstAutomationRead = 2;
+const int kVstAutomationWrite = 3;
+const int kVstAutomationReadWrite = 4;
+
 
 class RemoteVstPlugin;
 
@@ -290,6 +315,10 @@ class AEffect
 		int32_t version;
 		// processReplacing 50-53
 		void (* processReplacing)( AEffect * , float * * , float * * , int );
+		// processDoubleReplacing 54-57, null or zero filled before VST 2.4
+		void (* processDoubleReplacing)( AEffect * , double * * , double * * , int );
+		// Reserved, zero
+		char future[56];
 };
 
 typedef intptr_t (* audioMasterCallback)( AEffect * , int32_t, int32_t,
@@ -379,4 +408,71 @@ enum VstPlugCategory
 	kPlugCategMaxCount        // 12=Marker to count the categories
 };
 
+// from http://www.asseca.org/vst-24-specs/efSetSpeakerArrangement.html
+struct VstSpeakerProperties
+{
+	float azimuth;         // -PI to PI, 0 is straight ahead
+	float elevation;       // -PI/2 to PI/2, 0 is ear level
+	float radius;          // Distance in meters
+	float reserved;
+	char name[64];         // Speaker name, e.g. "L"
+	int32_t type;          // One of VstSpeakerType
+	char future[28];       // Reserved for future use
+};
+
+struct VstSpeakerArrangement
+{
+	int32_t type;                      // One of VstSpeakerArrangementType
+	int32_t numChannels;               // Number of used speakers
+	VstSpeakerProperties speakers[8];  // Variable sized in the SDK
+};
+
+enum VstSpeakerType
+{
+	kSpeakerUndefined = 0x7fffffff,
+	kSpeakerM = 0,  // Mono
+	kSpeakerL,      // Left
+	kSpeakerR,      // Right
+	kSpeakerC,      // Center
+	kSpeakerLfe,    // Subbass
+	kSpeakerLs,     // Left surround
+	kSpeakerRs,     // Right surround
+	kSpeakerLc,     // Left of center
+	kSpeakerRc,     // Right of center
+	kSpeakerS,      // Surround
+	kSpeakerCs = kSpeakerS,
+	kSpeakerSl,     // Side left
+	kSpeakerSr      // Side right
+};
+
+enum VstSpeakerArrangementType
+{
+	kSpeakerArrUserDefined = -2,
+	kSpeakerArrEmpty = -1,
+	kSpeakerArrMono = 0,      // M
+	kSpeakerArrStereo,        // L R
+	kSpeakerArrStereoSurround,
+	kSpeakerArrStereoCenter,
+	kSpeakerArrStereoSide,
+	kSpeakerArrStereoCLfe,
+	kSpeakerArr30Cine,
+	kSpeakerArr30Music,
+	kSpeakerArr31Cine,
+	kSpeakerArr31Music,
+	kSpeakerArr40Cine,        // L R C S
+	kSpeakerArr40Music,
+	kSpeakerArr41Cine,        // L R C Lfe S
+	kSpeakerArr41Music,
+	kSpeakerArr50,
+	kSpeakerArr51,            // L R C Lfe Ls Rs
+	kSpeakerArr60Cine,
+	kSpeakerArr60Music,
+	kSpeakerArr61Cine,
+	kSpeakerArr61Music,
+	kSpeakerArr70Cine,
+	kSpeakerArr70Music,
+	kSpeakerArr71Cine,
+	kSpeakerArr71Music        // L R C Lfe Ls Rs Sl Sr
+};
+
 #endif
\ No newline at end of file
@@ -63,6 +63,9 @@ AEffect *VSTPlugin::loadEffect()
 		return nullptr;
 	}
 
+	// Kept for further instances, see createPairs()
+	mainEntry = mainEntryPoint;
+
 	// Instantiate the plug-in
 	try {
 		plugin = mainEntryPoint(hostCallback_static);